@@ -0,0 +1,104 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "log.h"
+#include "modulator.h"
+#include "phy_mode.h"
+
+namespace SuperSonic {
+
+// Link adaptation: walk a ladder of phy modes, driven by the SNR and error
+// counts reported by the peer.
+class LinkAdapter {
+ public:
+  struct Rung {
+    PhyMode mode;
+    float rate;  // payload bits per sample
+    float min_snr_db;
+  };
+
+  struct Candidate {
+    PhyMode mode;
+    const Modulator* modulator;
+  };
+
+  // sort candidates by rate, and drop those needing more SNR than a faster one
+  static std::vector<Rung> make_ladder(const std::vector<Candidate>& candidates) {
+    std::vector<Rung> rungs;
+    for (auto& c : candidates) {
+      auto rate = (float)c.modulator->bits_per_symbol() /
+                  (float)c.modulator->symbol_samples() *
+                  code_rate(c.mode.coding);
+      auto min_snr_db =
+          c.modulator->min_snr_db() - coding_gain_db(c.mode.coding);
+      rungs.push_back({c.mode, rate, min_snr_db});
+    }
+    std::sort(rungs.begin(), rungs.end(),
+              [](auto& a, auto& b) { return a.rate < b.rate; });
+
+    std::vector<Rung> ladder;
+    for (auto& rung : rungs) {
+      while (!ladder.empty() && ladder.back().min_snr_db >= rung.min_snr_db) {
+        ladder.pop_back();
+      }
+      ladder.push_back(rung);
+    }
+    return ladder;
+  }
+
+  LinkAdapter(std::vector<Rung> ladder, float hysteresis_db, int up_reports)
+      : ladder_(std::move(ladder)),
+        hysteresis_db_(hysteresis_db),
+        up_reports_(up_reports) {
+    if (ladder_.empty()) {
+      LOG_ERROR("Empty link adaptation ladder");
+      throw std::runtime_error("Empty link adaptation ladder");
+    }
+  }
+
+  PhyMode mode() const { return ladder_[level_].mode; }
+  size_t level() const { return level_; }
+  const std::vector<Rung>& ladder() const { return ladder_; }
+
+  // step down at once on errors or low SNR,
+  // step up only after up_reports good reports in a row
+  void on_report(float snr_db, int errors) {
+    if (errors > 0 || snr_db < ladder_[level_].min_snr_db) {
+      good_reports_ = 0;
+      while (level_ > 0 && snr_db < ladder_[level_].min_snr_db) {
+        level_--;
+      }
+      if (errors > 0 && level_ > 0 &&
+          snr_db < ladder_[level_].min_snr_db + hysteresis_db_) {
+        level_--;
+      }
+      LOG_INFO("Link adaptation: snr {} dB, {} errors, level {}", snr_db,
+               errors, level_);
+      return;
+    }
+
+    if (level_ + 1 < ladder_.size() &&
+        snr_db >= ladder_[level_ + 1].min_snr_db + hysteresis_db_) {
+      good_reports_++;
+      if (good_reports_ >= up_reports_) {
+        good_reports_ = 0;
+        level_++;
+        LOG_INFO("Link adaptation: snr {} dB, level up to {}", snr_db, level_);
+      }
+    } else {
+      good_reports_ = 0;
+    }
+  }
+
+ private:
+  std::vector<Rung> ladder_;
+  float hysteresis_db_;
+  int up_reports_;
+
+  size_t level_ = 0;
+  int good_reports_ = 0;
+};
+
+}  // namespace SuperSonic
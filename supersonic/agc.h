@@ -0,0 +1,54 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <span>
+
+namespace SuperSonic {
+
+// Automatic gain control of the capture, block by block: the level follows
+// a rise within a block or two (attack) and a fall over about a second
+// (decay), so the gain holds steady through a frame. The sign of the gain
+// is the polarity of the capture chain, set from the preamble.
+class Agc {
+ public:
+  void process(std::span<float> block) {
+    if (block.empty()) {
+      return;
+    }
+    float energy = 0.0f;
+    for (auto e : block) {
+      energy += e * e;
+    }
+    auto rms = std::sqrt(energy / block.size());
+    auto rate = rms > level_ ? ATTACK : DECAY;
+    level_ += rate * (rms - level_);
+
+    auto g = gain();
+    for (auto& e : block) {
+      e *= g;
+    }
+  }
+
+  float gain() const {
+    auto g = level_ * MAX_GAIN > TARGET_RMS ? TARGET_RMS / level_ : MAX_GAIN;
+    return polarity_ * g;
+  }
+
+  void flip_polarity() { polarity_ = -polarity_; }
+  float polarity() const { return polarity_; }
+
+ private:
+  // about the level of a modulated payload
+  static constexpr float TARGET_RMS = 0.5f;
+  // per block of up to 256 samples
+  static constexpr float ATTACK = 0.5f;
+  static constexpr float DECAY = 0.005f;
+  // +60 dB, silence is not raised further
+  static constexpr float MAX_GAIN = 1000.0f;
+
+  float level_ = 0.0f;
+  float polarity_ = 1.0f;
+};
+
+}  // namespace SuperSonic
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+
+#include "magic.h"
 #include "modulator.h"
 #include "utils.h"
 
@@ -10,40 +14,56 @@ class ASK : public Modulator {
   static constexpr size_t symbol_len = 2;
   static constexpr std::array<float, symbol_len> one{0, 1};
   static constexpr std::array<float, symbol_len> zero{0, -1};
+  // one_dot - zero_dot of a symbol is its dot with one - zero
+  static constexpr std::array<float, symbol_len> diff = [] {
+    std::array<float, symbol_len> result{};
+    for (size_t j = 0; j < symbol_len; j++) {
+      result[j] = one[j] - zero[j];
+    }
+    return result;
+  }();
 
   size_t symbol_samples() const override { return symbol_len; }
   size_t bits_per_symbol() const override { return 1; }
+  float min_snr_db() const override { return 10.0f; }
+  // one sample per symbol carries the decision, its spectrum repeats up
+  // to Nyquist and all of it is signal
+  Band band() const override { return {0.0f, (float)kSampleRate / 2}; }
 
   Samples modulate(Bits raw_bits) override {
     Samples wave(raw_bits.size() * symbol_len);
     for (size_t i = 0; i < raw_bits.size(); i++) {
-      if (raw_bits[i]) {
-        for (size_t j = 0; j < symbol_len; j++) {
-          wave[i * symbol_len + j] = one[j];
-        }
-      } else {
-        for (size_t j = 0; j < symbol_len; j++) {
-          wave[i * symbol_len + j] = zero[j];
-        }
-      }
+      auto& pattern = raw_bits[i] ? one : zero;
+      std::copy(pattern.begin(), pattern.end(),
+                wave.begin() + i * symbol_len);
     }
     return wave;
   }
 
   Bits demodulate(SampleView wave) override {
-    using SuperSonic::Signal::dot;
+    return hard_decision(metrics(wave));
+  }
+
+  Llrs demodulate_soft(SampleView wave) override {
+    return Signal::metrics_to_llrs(metrics(wave));
+  }
+
+  // one_dot - zero_dot per symbol, symbol_len fixed at compile time
+  Samples metrics(SampleView wave) {
     if (wave.size() % symbol_len != 0) {
       LOG_ERROR("Invalid wave size: {}", wave.size());
       return {};
     }
-    Bits bits(wave.size() / symbol_len);
-    for (size_t i = 0; i < wave.size(); i += symbol_len) {
-      auto symbol = wave.subspan(i, symbol_len);
-      auto one_dot = dot(symbol, one);
-      auto zero_dot = dot(symbol, zero);
-      bits[i / symbol_len] = one_dot > zero_dot;
+    Samples result(wave.size() / symbol_len);
+    for (size_t i = 0; i < result.size(); i++) {
+      auto* symbol = wave.data() + i * symbol_len;
+      float metric = 0.0f;
+      for (size_t j = 0; j < symbol_len; j++) {
+        metric += symbol[j] * diff[j];
+      }
+      result[i] = metric;
     }
-    return bits;
+    return result;
   }
 
   size_t phy_payload_size(size_t bin_payload_size) const override {
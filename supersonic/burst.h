@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+
+#include "hamming.h"
+#include "log.h"
+#include "utils.h"
+
+namespace SuperSonic {
+
+// Burst payload: several frames sent under a single preamble.
+// Each sub-frame is its length (16 bits, Hamming(7,4) protected) followed by
+// its bits. Sub-frames carry their own CRC from the MAC layer, an invalid
+// length drops the rest of the burst.
+namespace Burst {
+
+static constexpr size_t len_bits = 16;
+static constexpr size_t len_encoded_bits =
+    Hamming::hamming_encoded_length(len_bits);
+
+// bits taken by a sub-frame of n bits
+constexpr size_t packed_size(size_t n) {
+  return len_encoded_bits + n;
+}
+
+inline Bits pack(const std::vector<Bits>& frames) {
+  Bits result;
+  for (auto& frame : frames) {
+    auto len = Hamming::hamming_encode(int2Bits(frame.size(), len_bits));
+    result.insert(result.end(), len.begin(), len.end());
+    result.insert(result.end(), frame.begin(), frame.end());
+  }
+  return result;
+}
+
+inline std::vector<Bits> unpack(BitView bits, size_t max_len) {
+  std::vector<Bits> frames;
+  size_t pos = 0;
+  while (pos + len_encoded_bits <= bits.size()) {
+    Bits encoded(bits.begin() + pos, bits.begin() + pos + len_encoded_bits);
+    size_t len = bits2Int(Hamming::hamming_decode(encoded));
+    pos += len_encoded_bits;
+    if (!(1 <= len && len <= max_len && pos + len <= bits.size())) {
+      LOG_WARN("Invalid burst sub-frame len: {}, dropping the rest", len);
+      break;
+    }
+    frames.emplace_back(bits.begin() + pos, bits.begin() + pos + len);
+    pos += len;
+  }
+  return frames;
+}
+
+}  // namespace Burst
+
+}  // namespace SuperSonic
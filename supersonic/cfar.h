@@ -0,0 +1,50 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+namespace SuperSonic {
+
+// Constant false alarm rate detection of the preamble: the correlation with
+// the chirp is compared with a threshold that follows the noise power,
+// estimated from the samples that left the correlation window, so a frame
+// does not raise its own threshold.
+class Cfar {
+ public:
+  // chirp_energy: sum of the squared chirp samples. factor: threshold in
+  // standard deviations of the correlation under noise only.
+  Cfar(float chirp_energy, float factor)
+      : chirp_energy_(chirp_energy), factor_(factor) {}
+
+  // a sample leaving the correlation window
+  void update(float e) {
+    // plain average while warming up, then exponential
+    samples_++;
+    auto alpha = std::max(1.0f / samples_, ALPHA);
+    noise_power_ += alpha * (e * e - noise_power_);
+  }
+
+  // the gain in front of the correlator changed by factor, the estimate
+  // follows at once
+  void rescale(float factor) { noise_power_ *= factor * factor; }
+
+  // threshold on dot(window, chirp)
+  float threshold() const {
+    return factor_ * std::sqrt(noise_power() * chirp_energy_);
+  }
+
+  float noise_power() const { return std::max(noise_power_, MIN_NOISE_POWER); }
+
+ private:
+  // ~4096 samples time constant
+  static constexpr float ALPHA = 1.0f / 4096;
+  // -80 dBFS, keeps digital silence from triggering on anything
+  static constexpr float MIN_NOISE_POWER = 1e-8f;
+
+  float chirp_energy_;
+  float factor_;
+  float noise_power_ = 0.0f;
+  size_t samples_ = 0;
+};
+
+}  // namespace SuperSonic
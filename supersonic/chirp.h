@@ -9,14 +9,17 @@ namespace SuperSonic {
 
 namespace Signal {
 
+// phase at time t of a chirp from f0, c Hz per second
+inline double chirp_phase(float f0, float c, double t) {
+  return 2 * std::numbers::pi * (c / 2 * t * t + f0 * t);
+}
+
 inline std::vector<float> generate_chirp(float f0,
                                                    float c,
                                                    float duration) {
   // auto f1 = c * duration + f0;
 
-  auto phi = [f0, c](float t) {
-    return 2 * std::numbers::pi * (c / 2 * t * t + f0 * t);
-  };
+  auto phi = [f0, c](float t) { return chirp_phase(f0, c, t); };
 
   auto t = linspace(0, duration, int(kSampleRate * duration));
   auto chirp = zeros(t.size());
@@ -32,8 +35,11 @@ inline std::vector<float> generate_chirp(float f0,
 }
 
 static constexpr size_t CHIRP1_LEN = 96 + 6;
+// sweeps from CHIRP1_F0 to CHIRP1_F1 and back
+static constexpr float CHIRP1_F0 = 5000;
+static constexpr float CHIRP1_F1 = 10000;
 inline auto generate_chirp1() {
-  return generate_chirp(5000, 5000000, 0.001f);
+  return generate_chirp(CHIRP1_F0, (CHIRP1_F1 - CHIRP1_F0) * 1000, 0.001f);
 }
 
 }  // namespace Signal
@@ -68,6 +68,24 @@ Option load_option(std::string filename) {
       saudio_opt.ringbuffer_size = *ringbuffer_size;
     }
 
+    if (j.as_object().contains("echo_option")) {
+      auto echo_option = j.at("echo_option").as_object();
+      auto& echo = saudio_opt.echo_option;
+      echo.enabled = value_opt(echo_option, "enabled")
+                         .transform([](const boost::json::value& v) {
+                           return v.as_bool();
+                         })
+                         .value_or(echo.enabled);
+      echo.delay = value_opt(echo_option, "delay")
+                       .transform(to_int)
+                       .value_or(echo.delay);
+      echo.taps =
+          value_opt(echo_option, "taps").transform(to_int).value_or(echo.taps);
+      echo.step = value_opt(echo_option, "step")
+                      .transform(to_float)
+                      .value_or(echo.step);
+    }
+
     // OFDM
     auto ofdm_opt = [&]() {
       if (!j.as_object().contains("ofdm_option")) {
@@ -110,13 +128,147 @@ Option load_option(std::string filename) {
           value_opt(sphy_option, "preamble_threshold").transform(to_float);
       auto max_payload_size =
           value_opt(sphy_option, "max_payload_size").transform(to_int);
-      if (bin_payload_size || frame_gap_size) {
-        return SphyOption(saudio_opt, *bin_payload_size, *frame_gap_size,
-                          *magic_factor, *preamble_threshold, *max_payload_size,
-                          ofdm_opt);
-      } else {
-        return SphyOption(saudio_opt);
+      auto result = (bin_payload_size || frame_gap_size)
+                        ? SphyOption(saudio_opt, *bin_payload_size,
+                                     *frame_gap_size, magic_factor,
+                                     preamble_threshold.value_or(0.1f),
+                                     *max_payload_size, ofdm_opt)
+                        : SphyOption(saudio_opt);
+
+      auto modulation =
+          value_opt(sphy_option, "modulation").transform(to_string);
+      if (modulation) {
+        auto m = parse_modulation(*modulation);
+        if (!m) {
+          throw std::runtime_error("Unknown modulation " + *modulation);
+        }
+        result.phy_mode.modulation = *m;
       }
+      result.timing_tracking = value_opt(sphy_option, "timing_tracking")
+                                   .transform([](const boost::json::value& v) {
+                                     return v.as_bool();
+                                   })
+                                   .value_or(result.timing_tracking);
+      result.max_clock_drift_ppm =
+          value_opt(sphy_option, "max_clock_drift_ppm")
+              .transform(to_float)
+              .value_or(result.max_clock_drift_ppm);
+
+      result.skew_correction = value_opt(sphy_option, "skew_correction")
+                                   .transform([](const boost::json::value& v) {
+                                     return v.as_bool();
+                                   })
+                                   .value_or(result.skew_correction);
+
+      auto coding = value_opt(sphy_option, "coding").transform(to_string);
+      if (coding) {
+        auto c = parse_coding(*coding);
+        if (!c) {
+          throw std::runtime_error("Unknown coding " + *coding);
+        }
+        result.phy_mode.coding = *c;
+      }
+      if (j.as_object().contains("pam_option")) {
+        auto pam_option = j.at("pam_option").as_object();
+        auto& pam = result.pam_option;
+        pam.levels =
+            value_opt(pam_option, "levels").transform(to_int).value_or(
+                pam.levels);
+        pam.symbol_samples = value_opt(pam_option, "symbol_samples")
+                                 .transform(to_int)
+                                 .value_or(pam.symbol_samples);
+        pam.rolloff = value_opt(pam_option, "rolloff")
+                          .transform(to_float)
+                          .value_or(pam.rolloff);
+        pam.span =
+            value_opt(pam_option, "span").transform(to_int).value_or(pam.span);
+      }
+      if (j.as_object().contains("fsk_option")) {
+        auto fsk_option = j.at("fsk_option").as_object();
+        auto& fsk = result.fsk_option;
+        fsk.tones =
+            value_opt(fsk_option, "tones").transform(to_int).value_or(fsk.tones);
+        fsk.symbol_samples = value_opt(fsk_option, "symbol_samples")
+                                 .transform(to_int)
+                                 .value_or(fsk.symbol_samples);
+        fsk.first_bin = value_opt(fsk_option, "first_bin")
+                            .transform(to_int)
+                            .value_or(fsk.first_bin);
+      }
+      if (j.as_object().contains("dpsk_option")) {
+        auto dpsk_option = j.at("dpsk_option").as_object();
+        auto& dpsk = result.dpsk_option;
+        dpsk.symbol_samples = value_opt(dpsk_option, "symbol_samples")
+                                  .transform(to_int)
+                                  .value_or(dpsk.symbol_samples);
+        dpsk.carrier_bin = value_opt(dpsk_option, "carrier_bin")
+                               .transform(to_int)
+                               .value_or(dpsk.carrier_bin);
+      }
+      if (j.as_object().contains("css_option")) {
+        auto css_option = j.at("css_option").as_object();
+        auto& css = result.css_option;
+        css.spreading_factor = value_opt(css_option, "spreading_factor")
+                                   .transform(to_int)
+                                   .value_or(css.spreading_factor);
+        css.oversampling = value_opt(css_option, "oversampling")
+                               .transform(to_int)
+                               .value_or(css.oversampling);
+        css.f0 =
+            value_opt(css_option, "f0").transform(to_float).value_or(css.f0);
+      }
+      if (j.as_object().contains("dsss_option")) {
+        auto dsss_option = j.at("dsss_option").as_object();
+        auto& dsss = result.dsss_option;
+        dsss.code_degree = value_opt(dsss_option, "code_degree")
+                               .transform(to_int)
+                               .value_or(dsss.code_degree);
+        dsss.chip_samples = value_opt(dsss_option, "chip_samples")
+                                .transform(to_int)
+                                .value_or(dsss.chip_samples);
+        dsss.carrier_cycles = value_opt(dsss_option, "carrier_cycles")
+                                  .transform(to_int)
+                                  .value_or(dsss.carrier_cycles);
+        dsss.code = value_opt(dsss_option, "code").transform(
+            [](const boost::json::value& v) { return (int)v.as_int64(); });
+        if (dsss_option.contains("peer_codes")) {
+          for (const auto& e : dsss_option.at("peer_codes").as_array()) {
+            dsss.peer_codes.push_back((int)e.as_int64());
+          }
+        }
+      }
+      if (j.as_object().contains("duplex_option")) {
+        auto duplex_option = j.at("duplex_option").as_object();
+        auto to_bool = [](const boost::json::value& v) { return v.as_bool(); };
+        auto& duplex = result.duplex_option;
+        duplex.enabled = value_opt(duplex_option, "enabled")
+                             .transform(to_bool)
+                             .value_or(duplex.enabled);
+        duplex.upper = value_opt(duplex_option, "upper").transform(to_bool);
+        duplex.split_channel = value_opt(duplex_option, "split_channel")
+                                   .transform(to_int)
+                                   .value_or(duplex.split_channel);
+        duplex.guard_channels = value_opt(duplex_option, "guard_channels")
+                                    .transform(to_int)
+                                    .value_or(duplex.guard_channels);
+      }
+      result.max_burst_ms = value_opt(sphy_option, "max_burst_ms")
+                                .transform(to_float)
+                                .value_or(result.max_burst_ms);
+      result.cfar_factor = value_opt(sphy_option, "cfar_factor")
+                               .transform(to_float)
+                               .value_or(result.cfar_factor);
+      result.rx_band_filter = value_opt(sphy_option, "rx_band_filter")
+                                  .transform([](const boost::json::value& v) {
+                                    return v.as_bool();
+                                  })
+                                  .value_or(result.rx_band_filter);
+      result.scramble = value_opt(sphy_option, "scramble")
+                            .transform([](const boost::json::value& v) {
+                              return v.as_bool();
+                            })
+                            .value_or(result.scramble);
+      return result;
     }();
 
     // Smac
@@ -151,6 +303,32 @@ Option load_option(std::string filename) {
         result.busy_power_threshold = busy_power_threshold;
         result.backoff_ms = backoff_ms;
         result.max_backoff_ms = max_backoff_ms;
+
+        result.adapt = value_opt(smac_option, "adapt")
+                           .transform([](const boost::json::value& v) {
+                             return v.as_bool();
+                           })
+                           .value_or(false);
+        if (smac_option.contains("adapt_modulations")) {
+          for (const auto& e : smac_option.at("adapt_modulations").as_array()) {
+            auto name = to_string(e);
+            auto m = parse_modulation(name);
+            if (!m) {
+              throw std::runtime_error("Unknown modulation " + name);
+            }
+            result.adapt_modulations.push_back(*m);
+          }
+        }
+        result.report_interval = value_opt(smac_option, "report_interval")
+                                     .transform(to_int)
+                                     .value_or(8);
+        result.adapt_hysteresis_db =
+            value_opt(smac_option, "adapt_hysteresis_db")
+                .transform(to_float)
+                .value_or(3.0f);
+        result.adapt_up_reports = value_opt(smac_option, "adapt_up_reports")
+                                      .transform(to_int)
+                                      .value_or(4);
         return result;
       } else {
         return {};
@@ -244,6 +422,15 @@ Option load_option(std::string filename) {
       }
     }();
 
+    // one DSSS code per node, by default the one of its address
+    if (!sphy_opt.dsss_option.code) {
+      sphy_opt.dsss_option.code = smac_opt.mac_addr;
+    }
+    // in full duplex the two ends of a link take opposite bands
+    if (!sphy_opt.duplex_option.upper) {
+      sphy_opt.duplex_option.upper = (smac_opt.mac_addr & 1) != 0;
+    }
+
     return {
         .sphy_option = sphy_opt,
         .smac_option = smac_opt,
@@ -1,19 +1,30 @@
 #pragma once
 
 #include <fmt/ranges.h>
+#include <optional>
 #include <variant>
 #include <vector>
 
 #include "chirp.h"
 #include "log.h"
 #include "magic.h"
-
-// #include "psk.h"
+#include "phy_mode.h"
 
 namespace SuperSonic {
 
 namespace Config {
 
+// see EchoCanceller
+struct EchoOption {
+  bool enabled = false;
+  // output to capture latency of the device, samples
+  int delay = 0;
+  // length of the echo path after delay, samples
+  int taps = 256;
+  // NLMS step, 0 to 2, smaller is slower and steadier
+  float step = 0.05f;
+};
+
 struct SaudioOption {
   std::string client_name = "supersonic";
 
@@ -23,6 +34,9 @@ struct SaudioOption {
   size_t ringbuffer_size = kSampleRate * 5;
 
   bool enable_raw_log = true;
+
+  // cancel our own output from the capture
+  EchoOption echo_option;
 };
 
 struct OFDMOption {
@@ -55,19 +69,128 @@ struct OFDMOption {
   }
 };
 
+struct PAMOption {
+  // 2, 4 or 8
+  int levels = 4;
+  // samples per symbol, the symbol rate is kSampleRate / symbol_samples
+  int symbol_samples = 4;
+  // root raised cosine roll-off, and pulse length in symbols (even)
+  float rolloff = 0.35f;
+  int span = 8;
+};
+
+struct FSKOption {
+  // 2, 4, 8 or 16, log2(tones) bits per symbol
+  int tones = 4;
+  // samples per symbol, also the tone spacing: kSampleRate / symbol_samples
+  int symbol_samples = 48;
+  // tone k at (first_bin + k) * kSampleRate / symbol_samples
+  int first_bin = 5;
+};
+
+// shared by DBPSK and DQPSK
+struct DPSKOption {
+  // samples per symbol, the symbol rate is kSampleRate / symbol_samples
+  int symbol_samples = 12;
+  // carrier at carrier_bin * kSampleRate / symbol_samples
+  int carrier_bin = 2;
+};
+
+struct CSSOption {
+  // bits per symbol, a symbol is 2^spreading_factor chips
+  int spreading_factor = 7;
+  // samples per chip, the bandwidth is kSampleRate / oversampling
+  int oversampling = 12;
+  // lowest frequency of the sweep, Hz
+  float f0 = 5000.0f;
+};
+
+struct DSSSOption {
+  // Gold codes of 2^code_degree - 1 chips, 5 or 7
+  int code_degree = 5;
+  // samples per chip, carrier_cycles of the carrier each
+  int chip_samples = 6;
+  int carrier_cycles = 1;
+  // code of this node, nullopt for the MAC address
+  std::optional<int> code;
+  // codes of the peers to listen to, empty for every code
+  std::vector<int> peer_codes;
+};
+
+// Frequency division full duplex: the OFDM channels are split at
+// split_channel into a low and a high band, each node sends in one and
+// listens to the other, so both can send at once
+struct DuplexOption {
+  bool enabled = false;
+  // this node sends in the high band, nullopt for the low bit of the MAC
+  // address
+  std::optional<bool> upper;
+  int split_channel = 7;
+  // channels left unused on either side of the split, room for the
+  // transition of the rx filter
+  int guard_channels = 1;
+
+  // the channels of ofdm in one band
+  OFDMOption band_option(const OFDMOption& ofdm, bool upper_band) const {
+    std::vector<int> channels;
+    for (auto ch : ofdm.channels) {
+      if (upper_band ? ch >= split_channel + guard_channels
+                     : ch < split_channel - guard_channels) {
+        channels.push_back(ch);
+      }
+    }
+    if (channels.empty()) {
+      LOG_ERROR("No OFDM channels in the {} band, split at {}",
+                upper_band ? "high" : "low", split_channel);
+      throw std::runtime_error("No OFDM channels in the band");
+    }
+    return OFDMOption(ofdm.symbol_freq, channels, ofdm.cp_samples);
+  }
+};
+
 struct SphyOption {
   SaudioOption saudio_option;
   const size_t bin_payload_size;
   const size_t frame_gap_size;
-  const float magic_factor;
+  // fixed gain (and polarity) of the capture, nullopt for Agc and the
+  // polarity detected from the preamble
+  const std::optional<float> magic_factor;
   const float preamble_threshold;
   const size_t max_payload_size;
   const OFDMOption ofdm_option;
+  PAMOption pam_option;
+  FSKOption fsk_option;
+  DPSKOption dpsk_option;
+  CSSOption css_option;
+  DSSSOption dsss_option;
+  DuplexOption duplex_option;
+
+  // default mode for tx, its modulation also carries the mode field
+  PhyMode phy_mode;
+
+  // track symbol timing during the payload
+  bool timing_tracking = true;
+  // sample clock difference to tolerate, sets how far past a frame we read
+  float max_clock_drift_ppm = 200.0f;
+  // resample the capture to the peer's sample clock, needs timing_tracking
+  bool skew_correction = true;
+  // frames queued while the channel is busy go out under one preamble,
+  // up to this long, 0 disables bursts
+  float max_burst_ms = 100.0f;
+  // preamble detection threshold over the running noise estimate, in
+  // standard deviations of the correlation, 0 uses preamble_threshold
+  float cfar_factor = 6.0f;
+  // filter the capture to the band of the chirp and the modulations in
+  // use, see Sphy::set_rx_band
+  bool rx_band_filter = true;
+  // scramble the coded payload, see scrambler.h. Receivers follow the
+  // header, so peers may differ
+  bool scramble = true;
 
   SphyOption(SaudioOption saudio_option,
              size_t bin_payload_size = 40,
              size_t frame_gap_size = 48,
-             float magic_factor = -1.0f,
+             std::optional<float> magic_factor = std::nullopt,
              float preamble_threshold = 0.1f,
              size_t max_payload_size = 2048,
              OFDMOption ofdm_option = OFDMOption())
@@ -87,6 +210,14 @@ struct SmacOption {
   int max_backoff_ms;
   int max_retries;
   float busy_power_threshold;
+
+  // link adaptation
+  bool adapt;
+  // empty means every modulation registered in Sphy
+  std::vector<Modulation> adapt_modulations;
+  int report_interval;
+  float adapt_hysteresis_db;
+  int adapt_up_reports;
 };
 
 struct TunOption {
@@ -46,4 +46,38 @@ bool validate_crc16(BitView bits) {
   return crc == recv_crc;
 }
 
+static uint8_t calc_crc8(BitView bits) {
+  Bytes bytes((bits.size() + 7) / 8);
+  for (size_t i = 0; i < bits.size(); i++) {
+    bytes[i / 8] |= bits[i] << (i % 8);
+  }
+  // CRC-8/SMBUS
+  boost::crc_optimal<8, 0x07, 0, 0, false, false> result;
+  result.process_bytes(bytes.data(), bytes.size());
+  return result.checksum();
+}
+
+Bits crc8(BitView bits) {
+  // return bits + crc
+  auto crc = calc_crc8(bits);
+  Bits crc_bits(8);
+  for (int i = 0; i < 8; i++) {
+    crc_bits[i] = (crc >> i) & 1;
+  }
+  return SuperSonic::Signal::concatenate(bits, crc_bits);
+}
+
+bool validate_crc8(BitView bits) {
+  // the last 8 bits are crc
+  if (bits.size() < 8) {
+    return false;
+  }
+  auto crc = calc_crc8(bits.subspan(0, bits.size() - 8));
+  uint8_t recv_crc = 0;
+  for (int i = 0; i < 8; i++) {
+    recv_crc |= bits[bits.size() - 8 + i] << i;
+  }
+  return crc == recv_crc;
+}
+
 }  // namespace SuperSonic
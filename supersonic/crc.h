@@ -6,5 +6,7 @@ namespace SuperSonic {
 
 Bits crc16(BitView bits);
 bool validate_crc16(BitView bits);
+Bits crc8(BitView bits);
+bool validate_crc8(BitView bits);
 
 }  // namespace SuperSonic
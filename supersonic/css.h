@@ -0,0 +1,132 @@
+#pragma once
+
+#include <kiss_fft.h>
+
+#include <cmath>
+#include <vector>
+
+#include "chirp.h"
+#include "config.h"
+#include "log.h"
+#include "magic.h"
+#include "modulator.h"
+#include "utils.h"
+
+namespace SuperSonic {
+
+// Chirp spread spectrum, LoRa style, for long range.
+// A symbol is the base chirp, f0 to f0 + bandwidth over 2^spreading_factor
+// chips of oversampling samples, cyclically shifted by a whole number of
+// chips. Multiplying by the conjugate base chirp turns shift s into a tone
+// on bin s of an FFT of the symbol, up to the wrap point, and on bin
+// s - 2^sf after it. Each doubling of the spreading factor halves the rate
+// and gains 3 dB.
+// Shifts are Gray coded: a timing or frequency error lands on the next
+// shift and costs one bit.
+class CSS : public Modulator {
+ public:
+  const Config::CSSOption opt;
+
+  CSS(Config::CSSOption opt) : opt(opt) {
+    auto bandwidth = (float)kSampleRate / opt.oversampling;
+    if (opt.spreading_factor < 5 || opt.spreading_factor > 12 ||
+        opt.oversampling < 2 || opt.f0 < bandwidth / 2 ||
+        2 * (opt.f0 + bandwidth) > kSampleRate - bandwidth) {
+      LOG_ERROR("Invalid CSS option: spreading_factor {} oversampling {} f0 {}",
+                opt.spreading_factor, opt.oversampling, opt.f0);
+      throw std::runtime_error("Invalid CSS option");
+    }
+    chips_ = (size_t)1 << opt.spreading_factor;
+    samples_ = chips_ * opt.oversampling;
+
+    // bandwidth over one symbol
+    auto c = bandwidth * kSampleRate / samples_;
+    base_.resize(samples_);
+    dechirp_.resize(samples_);
+    for (size_t n = 0; n < samples_; n++) {
+      auto phase = Signal::chirp_phase(opt.f0, c, (double)n / kSampleRate);
+      base_[n] = (float)std::cos(phase);
+      dechirp_[n] = {(float)std::cos(phase), (float)-std::sin(phase)};
+    }
+    cfg_ = kiss_fft_alloc(samples_, 0, 0, 0);
+  }
+  ~CSS() { free(cfg_); }
+  CSS(const CSS&) = delete;
+  CSS& operator=(const CSS&) = delete;
+
+  size_t phy_payload_size(size_t bin_payload_size) const override {
+    return (bin_payload_size + opt.spreading_factor - 1) /
+           opt.spreading_factor * samples_;
+  }
+  size_t symbol_samples() const override { return samples_; }
+  size_t bits_per_symbol() const override { return opt.spreading_factor; }
+  // in the chirp bandwidth about -3.5 dB at sf 7 and 2.5 dB lower per
+  // step (LoRa floors are 4 dB lower, with coherent combining of the wrap),
+  // over the whole band the noise is oversampling / 2 times more
+  float min_snr_db() const override {
+    return -3.5f - 2.5f * (opt.spreading_factor - 7) -
+           10.0f * std::log10(opt.oversampling / 2.0f);
+  }
+  Band band() const override {
+    return {opt.f0, opt.f0 + (float)kSampleRate / opt.oversampling};
+  }
+
+  Samples modulate(Bits bits) override {
+    auto sf = (size_t)opt.spreading_factor;
+    if (bits.size() % sf != 0) {
+      LOG_ERROR("Invalid bits size: {}", bits.size());
+      throw std::runtime_error("Invalid bits size");
+    }
+    Samples wave;
+    wave.reserve(bits.size() / sf * samples_);
+    for (size_t i = 0; i < bits.size(); i += sf) {
+      auto v = (size_t)bits2Int(BitView(bits).subspan(i, sf));
+      auto shift = (v ^ (v >> 1)) * opt.oversampling;
+      wave.insert(wave.end(), base_.begin() + shift, base_.end());
+      wave.insert(wave.end(), base_.begin(), base_.begin() + shift);
+    }
+    return wave;
+  }
+
+  Bits demodulate(SampleView wave) override {
+    return hard_decision(demodulate_soft(wave));
+  }
+
+  // the shift of a symbol carries its bits, see Signal::max_log_llrs
+  Llrs demodulate_soft(SampleView wave) override {
+    if (wave.size() % samples_ != 0) {
+      LOG_ERROR("Invalid wave size: {}", wave.size());
+      return {};
+    }
+    auto symbols = wave.size() / samples_;
+    std::vector<kiss_fft_cpx> in(samples_), out(samples_);
+    Samples mags(symbols * chips_);
+    for (size_t s = 0; s < symbols; s++) {
+      auto symbol = wave.subspan(s * samples_, samples_);
+      for (size_t n = 0; n < samples_; n++) {
+        in[n].r = symbol[n] * dechirp_[n].r;
+        in[n].i = symbol[n] * dechirp_[n].i;
+      }
+      kiss_fft(cfg_, in.data(), out.data());
+
+      // the tone before and after the wrap, noncoherently
+      for (size_t v = 0; v < chips_; v++) {
+        auto shift = v ^ (v >> 1);
+        auto& a = out[shift];
+        auto& b = out[samples_ - chips_ + shift];
+        mags[s * chips_ + v] =
+            std::sqrt(a.r * a.r + a.i * a.i + b.r * b.r + b.i * b.i);
+      }
+    }
+    return Signal::max_log_llrs(mags, chips_, opt.spreading_factor);
+  }
+
+ private:
+  size_t chips_;
+  size_t samples_;
+  Samples base_;
+  std::vector<kiss_fft_cpx> dechirp_;
+  kiss_fft_cfg cfg_;
+};
+
+}  // namespace SuperSonic
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <cmath>
+#include <numbers>
+#include <utility>
+#include <vector>
+
+#include "config.h"
+#include "log.h"
+#include "magic.h"
+#include "modulator.h"
+#include "utils.h"
+
+namespace SuperSonic {
+
+namespace Gold {
+
+// maximal length sequence of the polynomial x^degree + sum of x^i for the
+// bits i of taps, 2^degree - 1 bits
+inline Bits m_sequence(int degree, uint32_t taps) {
+  auto n = ((size_t)1 << degree) - 1;
+  Bits s(n);
+  s[0] = 1;
+  for (size_t k = 0; k + degree < n; k++) {
+    uint8_t bit = 0;
+    for (int i = 0; i < degree; i++) {
+      if ((taps >> i) & 1) {
+        bit ^= s[k + i];
+      }
+    }
+    s[k + degree] = bit;
+  }
+  return s;
+}
+
+// preferred pair of m-sequences: any two codes of the family cross correlate
+// to at most 2^((degree + 1) / 2) + 1
+inline std::pair<Bits, Bits> preferred_pair(int degree) {
+  switch (degree) {
+    case 5:
+      // x^5 + x^2 + 1, x^5 + x^4 + x^3 + x^2 + 1
+      return {m_sequence(5, 0b00101), m_sequence(5, 0b11101)};
+    case 7:
+      // x^7 + x^3 + 1, x^7 + x^3 + x^2 + x + 1
+      return {m_sequence(7, 0b0001001), m_sequence(7, 0b0001111)};
+    default:
+      LOG_ERROR("No Gold codes of degree {}", degree);
+      throw std::runtime_error("No Gold codes of this degree");
+  }
+}
+
+// 2^degree + 1 codes of 2^degree - 1 chips, in +-1
+inline std::vector<Samples> codes(int degree) {
+  auto [a, b] = preferred_pair(degree);
+  auto n = a.size();
+  std::vector<Samples> result;
+  auto add = [&](auto chip) {
+    Samples code(n);
+    for (size_t j = 0; j < n; j++) {
+      code[j] = chip(j) ? -1.0f : 1.0f;
+    }
+    result.push_back(std::move(code));
+  };
+  for (size_t k = 0; k < n; k++) {
+    add([&](size_t j) { return a[j] ^ b[(j + k) % n]; });
+  }
+  add([&](size_t j) { return a[j]; });
+  add([&](size_t j) { return b[j]; });
+  return result;
+}
+
+}  // namespace Gold
+
+// Direct sequence spread spectrum, one Gold code per node, so that nodes can
+// share the channel. Every bit is spread over the chips of the code of the
+// sender, each chip a burst of the carrier in one polarity; the bits are
+// sent differentially after a reference symbol, as in DPSK. The spread
+// symbol of our code is tabled once, a bit is a copy of it or its negation.
+// The receiver despreads with the code of each peer and follows the one
+// that gathers the most energy: another node sending on its own code at
+// the same time only adds its cross correlation, a fraction of the
+// processing gain, to the noise.
+class DSSS : public Modulator {
+ public:
+  const Config::DSSSOption opt;
+
+  DSSS(Config::DSSSOption opt) : opt(opt) {
+    if (opt.chip_samples < 2 || opt.carrier_cycles < 1 ||
+        2 * (opt.carrier_cycles + 1) > opt.chip_samples) {
+      LOG_ERROR("Invalid DSSS option: chip_samples {} carrier_cycles {}",
+                opt.chip_samples, opt.carrier_cycles);
+      throw std::runtime_error("Invalid DSSS option");
+    }
+    codes_ = Gold::codes(opt.code_degree);
+    tx_code_ = opt.code.value_or(0);
+    if (tx_code_ < 0 || tx_code_ >= (int)codes_.size()) {
+      LOG_ERROR("Invalid DSSS code: {}, {} codes", tx_code_, codes_.size());
+      throw std::runtime_error("Invalid DSSS code");
+    }
+    if (opt.peer_codes.empty()) {
+      for (int c = 0; c < (int)codes_.size(); c++) {
+        peer_codes_.push_back(c);
+      }
+    } else {
+      for (auto c : opt.peer_codes) {
+        if (c < 0 || c >= (int)codes_.size()) {
+          LOG_ERROR("Invalid DSSS code: {}, {} codes", c, codes_.size());
+          throw std::runtime_error("Invalid DSSS code");
+        }
+        peer_codes_.push_back(c);
+      }
+    }
+    for (int n = 0; n < opt.chip_samples; n++) {
+      auto w = 2 * std::numbers::pi_v<float> * opt.carrier_cycles * n /
+               opt.chip_samples;
+      cos_.push_back(std::cos(w));
+      sin_.push_back(std::sin(w));
+    }
+    for (auto c : codes_[tx_code_]) {
+      for (int n = 0; n < opt.chip_samples; n++) {
+        symbol_.push_back(c * cos_[n]);
+        inverted_.push_back(-c * cos_[n]);
+      }
+    }
+  }
+
+  size_t phy_payload_size(size_t bin_payload_size) const override {
+    return (bin_payload_size + 1) * samples_per_bit();
+  }
+  size_t symbol_samples() const override { return samples_per_bit(); }
+  size_t bits_per_symbol() const override { return 1; }
+  // DBPSK needs Es/N0 around 9 dB, a bit gathers samples_per_bit / 2
+  // times the sample snr
+  float min_snr_db() const override {
+    return 9.0f - 10.0f * std::log10(samples_per_bit() / 2.0f);
+  }
+  // main lobe of the chips around the carrier
+  Band band() const override {
+    auto chip_rate = (float)kSampleRate / opt.chip_samples;
+    return {(opt.carrier_cycles - 1) * chip_rate,
+            (opt.carrier_cycles + 1) * chip_rate};
+  }
+
+  Samples modulate(Bits bits) override {
+    Samples wave;
+    wave.reserve(phy_payload_size(bits.size()));
+    // reference symbol, then a flip for every 1
+    bool inverted = false;
+    for (size_t i = 0; i <= bits.size(); i++) {
+      if (i > 0 && bits[i - 1]) {
+        inverted = !inverted;
+      }
+      auto& symbol = inverted ? inverted_ : symbol_;
+      wave.insert(wave.end(), symbol.begin(), symbol.end());
+    }
+    return wave;
+  }
+
+  Bits demodulate(SampleView wave) override {
+    return hard_decision(demodulate_soft(wave));
+  }
+
+  // bit is 1 when the despread symbol flips from the one before
+  Llrs demodulate_soft(SampleView wave) override {
+    auto n = samples_per_bit();
+    if (wave.size() % n != 0 || wave.size() < n) {
+      LOG_ERROR("Invalid wave size: {}", wave.size());
+      return {};
+    }
+    // the carrier of every chip, I and Q
+    auto chips = wave.size() / opt.chip_samples;
+    Samples re(chips), im(chips);
+    for (size_t j = 0; j < chips; j++) {
+      auto chip = wave.subspan(j * opt.chip_samples, opt.chip_samples);
+      for (int k = 0; k < opt.chip_samples; k++) {
+        re[j] += chip[k] * cos_[k];
+        im[j] -= chip[k] * sin_[k];
+      }
+    }
+
+    // despread with every peer code, keep the strongest
+    auto symbols = wave.size() / n;
+    auto code_len = codes_[0].size();
+    Samples best_re, best_im;
+    float best_energy = -1.0f;
+    for (auto c : peer_codes_) {
+      auto& code = codes_[c];
+      Samples zr(symbols), zi(symbols);
+      float energy = 0.0f;
+      for (size_t s = 0; s < symbols; s++) {
+        for (size_t j = 0; j < code_len; j++) {
+          zr[s] += code[j] * re[s * code_len + j];
+          zi[s] += code[j] * im[s * code_len + j];
+        }
+        energy += zr[s] * zr[s] + zi[s] * zi[s];
+      }
+      if (energy > best_energy) {
+        best_energy = energy;
+        best_re = std::move(zr);
+        best_im = std::move(zi);
+        last_rx_code_ = c;
+      }
+    }
+
+    Samples metrics(symbols - 1);
+    for (size_t s = 1; s < symbols; s++) {
+      metrics[s - 1] =
+          -(best_re[s] * best_re[s - 1] + best_im[s] * best_im[s - 1]);
+    }
+    return Signal::metrics_to_llrs(std::move(metrics));
+  }
+
+  // code of the sender of the last demodulated wave
+  int last_rx_code() const { return last_rx_code_; }
+
+ private:
+  size_t samples_per_bit() const {
+    return codes_[0].size() * opt.chip_samples;
+  }
+
+  std::vector<Samples> codes_;
+  int tx_code_;
+  std::vector<int> peer_codes_;
+  int last_rx_code_ = -1;
+  Samples cos_;
+  Samples sin_;
+  // spread symbol of our code, and its negation
+  Samples symbol_;
+  Samples inverted_;
+};
+
+}  // namespace SuperSonic
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#include "config.h"
+#include "utils.h"
+
+namespace SuperSonic {
+
+// Adaptive cancellation of our own output in the capture, NLMS.
+// The echo of output x in capture d is modelled as an FIR of opt.taps taps
+// after opt.delay samples of latency:
+//   y[n] = sum w[j] * x[n - delay - j], e[n] = d[n] - y[n]
+// and w follows e, w += step * e * x / |x|^2. The capture keeps e: another
+// node, or the peer in full duplex, stays while our own signal is gone.
+// Adaptation stops while the reference is silent, nothing to learn from it;
+// while we send, a louder other node only slows it, the step is small.
+// Runs in the audio thread: the reference history keeps its capacity, no
+// allocation once the callback size settled.
+class EchoCanceller {
+ public:
+  const Config::EchoOption opt;
+
+  // regularization of |x|^2, about -60 dB of full scale per tap
+  static constexpr float EPSILON = 1e-6f;
+
+  explicit EchoCanceller(Config::EchoOption opt) : opt(opt) {
+    if (opt.delay < 0 || opt.taps < 1 || opt.step <= 0.0f ||
+        opt.step >= 2.0f) {
+      LOG_ERROR("Invalid echo option: delay {} taps {} step {}", opt.delay,
+                opt.taps, opt.step);
+      throw std::runtime_error("Invalid echo option");
+    }
+    weights_.assign(opt.taps, 0.0f);
+    history_.assign(opt.delay + opt.taps - 1, 0.0f);
+  }
+
+  // out: capture, echo removed. tx: the output of the same samples, must
+  // be passed here before it goes to the device
+  void process(const float* in, const float* tx, float* out, size_t n) {
+    auto base = history_.size();
+    history_.insert(history_.end(), tx, tx + n);
+    auto taps = weights_.size();
+    for (size_t i = 0; i < n; i++) {
+      // x[n - delay - taps + 1 .. n - delay], oldest first
+      const float* x = history_.data() + base + i + 1 - opt.delay - taps;
+      auto newest = x[taps - 1];
+      ref_energy_ += newest * newest;
+      auto e = in[i] - dot(x);
+      out[i] = e;
+      if (ref_energy_ > taps * EPSILON) {
+        axpy(opt.step * e / (ref_energy_ + taps * EPSILON), x);
+      }
+      // leaves the window before the next sample
+      ref_energy_ = std::max(ref_energy_ - x[0] * x[0], 0.0f);
+    }
+    history_.erase(history_.begin(), history_.begin() + n);
+    // once per block, no drift from the running sum
+    ref_energy_ = 0.0f;
+    for (size_t j = 0; j + 1 < taps; j++) {
+      ref_energy_ += history_[j] * history_[j];
+    }
+  }
+
+  // echo path estimate, weights_[j] for x[n - delay - taps + 1 + j]
+  SampleView weights() const { return weights_; }
+
+ private:
+  float dot(const float* x) const {
+    size_t j = 0;
+    float result = 0.0f;
+    auto taps = weights_.size();
+#if defined(__SSE2__) || defined(_M_X64)
+    auto acc = _mm_setzero_ps();
+    for (; j + 4 <= taps; j += 4) {
+      acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(x + j),
+                                       _mm_loadu_ps(weights_.data() + j)));
+    }
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, acc);
+    result = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+    for (; j < taps; j++) {
+      result += x[j] * weights_[j];
+    }
+    return result;
+  }
+
+  // weights_ += a * x
+  void axpy(float a, const float* x) {
+    size_t j = 0;
+    auto taps = weights_.size();
+#if defined(__SSE2__) || defined(_M_X64)
+    auto va = _mm_set1_ps(a);
+    for (; j + 4 <= taps; j += 4) {
+      auto w = _mm_loadu_ps(weights_.data() + j);
+      _mm_storeu_ps(weights_.data() + j,
+                    _mm_add_ps(w, _mm_mul_ps(va, _mm_loadu_ps(x + j))));
+    }
+#endif
+    for (; j < taps; j++) {
+      weights_[j] += a * x[j];
+    }
+  }
+
+  Samples weights_;
+  // reference, delay + taps - 1 samples before the block being processed
+  Samples history_;
+  // |x|^2 over the window of the next sample but its newest one
+  float ref_energy_ = 0.0f;
+};
+
+}  // namespace SuperSonic
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#include "magic.h"
+#include "modulator.h"
+#include "utils.h"
+
+namespace SuperSonic {
+
+// Streaming front-end filter of the capture: a one-pole DC blocker, then a
+// linear phase FIR (Hamming windowed sinc), a low-pass flat up to band.high,
+// or a band-pass also flat down from band.low when the band starts well
+// above DC, e.g. to keep our own band out in full duplex.
+// The FIR delays everything by (TAPS - 1) / 2 samples, the same for the
+// preamble and the payload, so frame timing is unaffected. Each output is
+// a dot product of contiguous samples with the taps, 4 at a time with SSE2.
+class BandFilter {
+ public:
+  static constexpr size_t TAPS = 63;
+  // transition width of the Hamming window, Hz
+  static constexpr float TRANSITION = 3.3f * kSampleRate / TAPS;
+
+  explicit BandFilter(Band band) {
+    // lowest band edge sets the DC blocker, far below it to keep the phase
+    // flat in band
+    auto dc_cutoff = std::clamp(band.low / 8, 10.0f, 100.0f);
+    dc_pole_ = std::exp(-2 * std::numbers::pi_v<float> * dc_cutoff /
+                        kSampleRate);
+
+    // flat up to band.high, a band reaching Nyquist needs no low-pass
+    auto cutoff = band.high + TRANSITION / 2;
+    lowpass_ = cutoff < kSampleRate / 2 - TRANSITION / 2;
+    // flat down to band.low, the dc blocker is enough near DC
+    auto low_cutoff = band.low - TRANSITION / 2;
+    highpass_ = low_cutoff > TRANSITION;
+    if (!lowpass_ && !highpass_) {
+      return;
+    }
+
+    // band-pass as the difference of two low-passes
+    if (lowpass_) {
+      taps_ = lowpass_taps(cutoff);
+    } else {
+      taps_.assign(TAPS, 0.0f);
+      taps_[(TAPS - 1) / 2] = 1.0f;
+    }
+    if (highpass_) {
+      auto stop = lowpass_taps(low_cutoff);
+      for (size_t i = 0; i < TAPS; i++) {
+        taps_[i] -= stop[i];
+      }
+    }
+    history_.assign(TAPS - 1, 0.0f);
+  }
+
+  bool lowpass() const { return lowpass_; }
+  bool highpass() const { return highpass_; }
+  // samples between an input and the output it mostly shows in
+  size_t delay() const { return fir() ? (TAPS - 1) / 2 : 0; }
+
+  // filter in, append to out
+  void process(SampleView in, Samples& out) {
+    auto base = history_.size();
+    history_.resize(base + in.size());
+    for (size_t i = 0; i < in.size(); i++) {
+      // y[n] = x[n] - x[n - 1] + pole * y[n - 1]
+      auto y = in[i] - dc_x_ + dc_pole_ * dc_y_;
+      dc_x_ = in[i];
+      dc_y_ = y;
+      history_[base + i] = y;
+    }
+
+    if (!fir()) {
+      out.insert(out.end(), history_.begin(), history_.end());
+      history_.clear();
+      return;
+    }
+
+    auto n = history_.size() - (TAPS - 1);
+    auto start = out.size();
+    out.resize(start + n);
+    for (size_t k = 0; k < n; k++) {
+      out[start + k] = fir_at(history_.data() + k);
+    }
+    history_.erase(history_.begin(), history_.begin() + n);
+  }
+
+ private:
+  bool fir() const { return lowpass_ || highpass_; }
+
+  // Hamming windowed sinc, unity gain at DC
+  static std::vector<float> lowpass_taps(float cutoff) {
+    auto fc = cutoff / kSampleRate;
+    std::vector<float> taps(TAPS);
+    float sum = 0.0f;
+    for (size_t i = 0; i < TAPS; i++) {
+      auto n = (float)i - (TAPS - 1) / 2.0f;
+      auto sinc = n == 0 ? 2 * fc
+                         : std::sin(2 * std::numbers::pi_v<float> * fc * n) /
+                               (std::numbers::pi_v<float> * n);
+      auto window = 0.54f - 0.46f * std::cos(2 * std::numbers::pi_v<float> *
+                                             i / (TAPS - 1));
+      taps[i] = sinc * window;
+      sum += taps[i];
+    }
+    for (auto& e : taps) {
+      e /= sum;
+    }
+    return taps;
+  }
+
+  // dot product of x[0 .. TAPS) with the taps
+  float fir_at(const float* x) const {
+    size_t j = 0;
+    float result = 0.0f;
+#if defined(__SSE2__) || defined(_M_X64)
+    auto acc = _mm_setzero_ps();
+    for (; j + 4 <= TAPS; j += 4) {
+      acc = _mm_add_ps(
+          acc, _mm_mul_ps(_mm_loadu_ps(x + j), _mm_loadu_ps(taps_.data() + j)));
+    }
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, acc);
+    result = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+    for (; j < TAPS; j++) {
+      result += x[j] * taps_[j];
+    }
+    return result;
+  }
+
+  float dc_pole_;
+  float dc_x_ = 0.0f;
+  float dc_y_ = 0.0f;
+  bool lowpass_ = false;
+  bool highpass_ = false;
+  std::vector<float> taps_;
+  // dc blocked input, TAPS - 1 samples of history first
+  Samples history_;
+};
+
+}  // namespace SuperSonic
@@ -1,70 +1,121 @@
 #pragma once
 
-#include <kiss_fft.h>
+#include <cmath>
+#include <numbers>
+#include <vector>
 
-#include "supersonic.h"
+#include "config.h"
+#include "log.h"
+#include "magic.h"
+#include "modulator.h"
 #include "utils.h"
 
 namespace SuperSonic {
-namespace Signal {
 
-struct FSKOption {
-  float freq;
-  int symbol_samples;
-  float symbol_time;
-  constexpr FSKOption(float freq)
-      : freq(freq),
-        symbol_samples(kSampleRate / freq),
-        symbol_time(1.0 / freq) {}
-};
-
-inline Samples fsk_modulate(BitView bits, FSKOption opt) {
-  auto t = linspace(0, opt.symbol_time, opt.symbol_samples);
-  auto one = sine_wave(opt.freq, t);
-  auto zero = sine_wave(opt.freq * 2, t);
+// Continuous phase M-ary FSK, detected noncoherently.
+// Tone k sits on DFT bin first_bin + k of a symbol, so the tones are
+// orthogonal and each symbol holds whole cycles: every symbol starts at the
+// phase the one before ended on, no jump at the boundaries to splatter,
+// and the waves of the tones are tabled once. The detector
+// runs a Goertzel filter per tone: O(symbol_samples) per tone and symbol,
+// only the bins in use.
+class FSK : public Modulator {
+ public:
+  const Config::FSKOption opt;
 
-  Samples wave;
-  for (auto e : bits) {
-    if (e) {
-      wave.insert(wave.end(), one.begin(), one.end());
-    } else {
-      wave.insert(wave.end(), zero.begin(), zero.end());
+  FSK(Config::FSKOption opt) : opt(opt) {
+    if (!(opt.tones == 2 || opt.tones == 4 || opt.tones == 8 ||
+          opt.tones == 16) ||
+        opt.symbol_samples < 4 || opt.first_bin < 1 ||
+        2 * (opt.first_bin + opt.tones) > opt.symbol_samples) {
+      LOG_ERROR("Invalid FSK option: tones {} symbol_samples {} first_bin {}",
+                opt.tones, opt.symbol_samples, opt.first_bin);
+      throw std::runtime_error("Invalid FSK option");
+    }
+    bits_ = (size_t)std::log2(opt.tones);
+    rows_.resize(opt.tones * opt.symbol_samples);
+    for (int k = 0; k < opt.tones; k++) {
+      auto w = 2 * std::numbers::pi * (opt.first_bin + k) / opt.symbol_samples;
+      for (int j = 0; j < opt.symbol_samples; j++) {
+        rows_[k * opt.symbol_samples + j] = (float)std::sin(w * j);
+      }
+      coeff_.push_back(2 * (float)std::cos(w));
     }
   }
-  return wave;
-}
 
-inline Bits fsk_demodulate(SampleView wave, FSKOption opt) {
-  if (wave.size() % opt.symbol_samples != 0) {
-    LOG_ERROR("Invalid wave size: {}", wave.size());
-    return {};
+  size_t phy_payload_size(size_t bin_payload_size) const override {
+    return (bin_payload_size + bits_ - 1) / bits_ * opt.symbol_samples;
+  }
+  size_t symbol_samples() const override { return opt.symbol_samples; }
+  size_t bits_per_symbol() const override { return bits_; }
+  // noncoherent detection needs Es/N0 around 13 dB, a symbol gathers
+  // symbol_samples / 2 times the sample snr
+  float min_snr_db() const override {
+    return 13.0f - 10.0f * std::log10(opt.symbol_samples / 2.0f);
+  }
+  // tones, with the main lobe of the outer ones
+  Band band() const override {
+    auto spacing = (float)kSampleRate / opt.symbol_samples;
+    return {(opt.first_bin - 1) * spacing,
+            (opt.first_bin + opt.tones) * spacing};
   }
 
-  auto t = linspace(0, opt.symbol_time, opt.symbol_samples);
-
-  auto cfg = kiss_fft_alloc(opt.symbol_samples, 0, 0, 0);
-  kiss_fft_cpx in[opt.symbol_samples], out[opt.symbol_samples];
-
-  Bits bits;
-  bits.reserve(wave.size() / opt.symbol_samples);
-  for (size_t i = 0; i < wave.size(); i += opt.symbol_samples) {
-    SampleView symbol(wave.begin() + i, opt.symbol_samples);
-    for (size_t j = 0; j < opt.symbol_samples; j++) {
-      in[j].r = symbol[j];
-      in[j].i = 0;
+  Samples modulate(Bits bits) override {
+    if (bits.size() % bits_ != 0) {
+      LOG_ERROR("Invalid bits size: {}", bits.size());
+      throw std::runtime_error("Invalid bits size");
     }
+    Samples wave;
+    wave.reserve(bits.size() / bits_ * opt.symbol_samples);
+    for (size_t i = 0; i < bits.size(); i += bits_) {
+      auto row = rows_.begin() +
+                 bits2Int(BitView(bits).subspan(i, bits_)) * opt.symbol_samples;
+      wave.insert(wave.end(), row, row + opt.symbol_samples);
+    }
+    return wave;
+  }
 
-    kiss_fft(cfg, in, out);
+  Bits demodulate(SampleView wave) override {
+    return hard_decision(demodulate_soft(wave));
+  }
+
+  // the tone of a symbol carries its bits, see Signal::max_log_llrs
+  Llrs demodulate_soft(SampleView wave) override {
+    return Signal::max_log_llrs(magnitudes(wave), opt.tones, bits_);
+  }
 
-    float f1_mag = std::sqrt(out[1].r * out[1].r + out[1].i * out[1].i);
-    float f2_mag = std::sqrt(out[2].r * out[2].r + out[2].i * out[2].i);
-    bits.push_back(f1_mag > f2_mag);
+ private:
+  // |X(bin)| of every tone, tones per symbol
+  Samples magnitudes(SampleView wave) const {
+    if (wave.size() % opt.symbol_samples != 0) {
+      LOG_ERROR("Invalid wave size: {}", wave.size());
+      return {};
+    }
+    auto symbols = wave.size() / opt.symbol_samples;
+    Samples mags(symbols * opt.tones);
+    for (size_t s = 0; s < symbols; s++) {
+      auto symbol = wave.subspan(s * opt.symbol_samples, opt.symbol_samples);
+      for (int k = 0; k < opt.tones; k++) {
+        mags[s * opt.tones + k] = goertzel(symbol, coeff_[k]);
+      }
+    }
+    return mags;
   }
 
-  free(cfg);
+  static float goertzel(SampleView x, float coeff) {
+    float s1 = 0.0f, s2 = 0.0f;
+    for (auto e : x) {
+      auto s0 = e + coeff * s1 - s2;
+      s2 = s1;
+      s1 = s0;
+    }
+    return std::sqrt(std::max(s1 * s1 + s2 * s2 - coeff * s1 * s2, 0.0f));
+  }
 
-  return bits;
-}
+  size_t bits_;
+  // tone k at k * symbol_samples
+  Samples rows_;
+  std::vector<float> coeff_;
+};
 
-}  // namespace Signal
-}  // namespace SuperSonic
\ No newline at end of file
+}  // namespace SuperSonic
@@ -13,6 +13,7 @@
 #include <map>
 #include <utility>
 
+#include "adapt.h"
 #include "crc.h"
 #include "phy.h"
 #include "utils.h"
@@ -42,6 +43,8 @@ class Smac {
   enum class FrameType : uint8_t {
     Data = 0,
     Ack = 1,
+    // link quality report, see make_report
+    Report = 2,
   };
 
   struct Frame {
@@ -50,8 +53,19 @@ class Smac {
     FrameType type;
     uint8_t seq;
     Bits payload;
+    // measured by Sphy on receive, not transmitted
+    float snr_db = 0.0f;
   };
 
+  // Report payload: snr (8 bits, 0.5 dB steps) + crc errors (8 bits)
+  static constexpr int report_bits = 16;
+  struct Report {
+    float snr_db;
+    int errors;
+  };
+  static Bits make_report(const Report& report);
+  static Report parse_report(BitView payload);
+
   uint8_t get_frame_src(BitView frame);
   void set_frame_src(MutBitView frame, uint8_t src);
   uint8_t get_frame_dest(BitView frame);
@@ -70,6 +84,14 @@ class Smac {
       throw std::runtime_error("Invalid mac addr");
     }
     LOG_INFO("Smac mac addr {}", opt_.mac_addr);
+    // frames for other nodes are dropped in Sphy, before demodulation
+    phy_.set_rx_filter(opt_.mac_addr);
+    // payloads may come in any modulation of the ladder
+    if (opt_.adapt) {
+      phy_.set_rx_band(opt_.adapt_modulations.empty()
+                           ? phy_.modulations()
+                           : opt_.adapt_modulations);
+    }
   }
 
   awaitable<void> run();
@@ -79,11 +101,18 @@ class Smac {
   awaitable<Bits> rx();
 
   awaitable<void> tx_frame(Frame frame) {
+    co_await tx_frame(std::move(frame), phy_.tx_mode());
+  }
+
+  // returns once queued, the next frame is modulated while this one plays
+  awaitable<void> tx_frame(Frame frame, PhyMode mode) {
     auto bits = make_frame(frame);
-    co_await phy_.tx(bits);
-    co_await phy_.tx_finish();
+    co_await phy_.tx(bits, mode, frame.dest);
   }
 
+  // per destination link adaptation, created on first use
+  LinkAdapter& adapter(uint8_t dest);
+
   using TxChannel =
       boost::asio::experimental::channel<void(boost::system::error_code, Bits)>;
   using TxCompChannel =
@@ -103,6 +132,10 @@ class Smac {
 
   const Config::SmacOption opt_;
   Sphy& phy_;
+
+  std::map<uint8_t, LinkAdapter> adapters_;
+  // crc failures since the last report
+  int rx_crc_errors_ = 0;
 };
 
 }  // namespace SuperSonic
\ No newline at end of file
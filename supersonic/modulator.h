@@ -2,12 +2,26 @@
 #include "utils.h"
 
 namespace SuperSonic {
+// occupied band, Hz
+struct Band {
+  float low;
+  float high;
+};
+
 class Modulator {
  public:
+  virtual ~Modulator() = default;
+
   virtual Samples modulate(Bits raw_bits) = 0;
   virtual Bits demodulate(SampleView wave) = 0;
+  // same bits as demodulate, with confidence
+  virtual Llrs demodulate_soft(SampleView wave) = 0;
   virtual size_t phy_payload_size(size_t bin_payload_size) const = 0;
   virtual size_t symbol_samples() const = 0;
   virtual size_t bits_per_symbol() const = 0;
+  // rough SNR (over the whole wave) needed for a low uncoded BER
+  virtual float min_snr_db() const = 0;
+  // band the demodulator looks at, see BandFilter
+  virtual Band band() const = 0;
 };
 }  // namespace SuperSonic
\ No newline at end of file
@@ -2,6 +2,12 @@
 
 #include <kiss_fft.h>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <memory>
+#include <numbers>
+
 #include "config.h"
 #include "modulator.h"
 #include "utils.h"
@@ -20,17 +26,179 @@ namespace SuperSonic {
 // static constexpr std::array<int, 2> channels = {1, 2};
 // static constexpr int opt.symbol_bits = 1;
 
+// Precomputed symbols of OFDM: the channels are taken GROUP at a time, and
+// for each group the core of a symbol (no cyclic prefix) is tabled for
+// every pattern of its bits, sin for 1 and cos for 0 as the inverse FFT
+// makes them. A symbol is then the sum of one row per group, 3 rows for
+// 12 channels, 16 rows of N samples per group.
+namespace OFDMTable {
+
+static constexpr size_t GROUP = 4;
+static constexpr size_t ROWS = 1 << GROUP;
+
+constexpr size_t groups(size_t channels) {
+  return (channels + GROUP - 1) / GROUP;
+}
+
+// row p of group g at (g * ROWS + p) * n
+inline Samples rows(const std::vector<int>& channels, int n) {
+  // the inverse FFT puts 0.5 / channels on bins channel and n - channel
+  auto amp = 1.0f / channels.size();
+  Samples result(groups(channels.size()) * ROWS * n, 0.0f);
+  for (size_t c = 0; c < channels.size(); c++) {
+    auto g = c / GROUP, bit = c % GROUP;
+    for (size_t p = 0; p < ROWS; p++) {
+      auto* row = result.data() + (g * ROWS + p) * n;
+      for (int k = 0; k < n; k++) {
+        auto w = 2 * std::numbers::pi * channels[c] * k / n;
+        row[k] += amp * (float)((p >> bit) & 1 ? std::sin(w) : std::cos(w));
+      }
+    }
+  }
+  return result;
+}
+
+// bits of group g, bits holds the bits of a symbol from its start
+inline size_t pattern(const uint8_t* bits, size_t channels, size_t g) {
+  size_t p = 0;
+  for (size_t j = 0; j < GROUP && g * GROUP + j < channels; j++) {
+    p |= (size_t)bits[g * GROUP + j] << j;
+  }
+  return p;
+}
+
+}  // namespace OFDMTable
+
+// OFDM symbols of whole frames, for OFDM::modulate and OFDM::metrics
+class OFDMKernel {
+ public:
+  virtual ~OFDMKernel() = default;
+  // bits.size() / channels symbols into wave
+  virtual void modulate(BitView bits, MutSampleView wave) const = 0;
+  // |sin| - |cos| per channel per symbol
+  virtual void metrics(SampleView wave, MutSampleView result) const = 0;
+};
+
+// A profile fixed at compile time: N samples a symbol after a cyclic prefix
+// of CP, on Channels. A symbol is a sum of rows of OFDMTable, and read back
+// by a correlation with the channels in use over tables of N samples
+// instead of an FFT, loops of constant trip counts the compiler unrolls and
+// vectorizes (4 lanes for the sums). Same waves and metrics as the kiss_fft
+// path, up to rounding.
+template <int N, int CP, int... Channels>
+class FixedOFDMKernel : public OFDMKernel {
+ public:
+  static constexpr size_t C = sizeof...(Channels);
+  static constexpr std::array<int, C> CHANNELS{Channels...};
+  static constexpr int SYMBOL = CP + N;
+  static constexpr size_t GROUPS = OFDMTable::groups(C);
+  static_assert(N % 4 == 0 && CP <= N);
+
+  FixedOFDMKernel() {
+    auto rows = OFDMTable::rows({Channels...}, N);
+    std::copy(rows.begin(), rows.end(), rows_.begin());
+    for (size_t c = 0; c < C; c++) {
+      for (int n = 0; n < N; n++) {
+        auto w = 2 * std::numbers::pi * CHANNELS[c] * n / N;
+        cos_[c][n] = (float)std::cos(w);
+        sin_[c][n] = (float)std::sin(w);
+      }
+    }
+  }
+
+  static bool matches(const Config::OFDMOption& opt) {
+    return opt.real_symbol_samples == N && opt.cp_samples == CP &&
+           std::ranges::equal(opt.channels, CHANNELS);
+  }
+
+  void modulate(BitView bits, MutSampleView wave) const override {
+    for (size_t s = 0; s < bits.size() / C; s++) {
+      auto* symbol = wave.data() + s * SYMBOL;
+      auto* core = symbol + CP;
+      std::array<float, N> acc{};
+      for (size_t g = 0; g < GROUPS; g++) {
+        auto p = OFDMTable::pattern(bits.data() + s * C, C, g);
+        auto* row = rows_.data() + (g * OFDMTable::ROWS + p) * N;
+        for (int n = 0; n < N; n++) {
+          acc[n] += row[n];
+        }
+      }
+      std::copy(acc.begin(), acc.end(), core);
+      std::copy(core + N - CP, core + N, symbol);
+    }
+  }
+
+  void metrics(SampleView wave, MutSampleView result) const override {
+    for (size_t s = 0; s < wave.size() / SYMBOL; s++) {
+      auto* core = wave.data() + s * SYMBOL + CP;
+      for (size_t c = 0; c < C; c++) {
+        std::array<float, 4> re{}, im{};
+        for (int n = 0; n < N; n += 4) {
+          for (int k = 0; k < 4; k++) {
+            re[k] += core[n + k] * cos_[c][n + k];
+            im[k] += core[n + k] * sin_[c][n + k];
+          }
+        }
+        result[s * C + c] = std::abs(im[0] + im[1] + im[2] + im[3]) -
+                            std::abs(re[0] + re[1] + re[2] + re[3]);
+      }
+    }
+  }
+
+ private:
+  alignas(16) std::array<float, GROUPS * OFDMTable::ROWS * N> rows_;
+  alignas(16) std::array<std::array<float, N>, C> cos_;
+  alignas(16) std::array<std::array<float, N>, C> sin_;
+};
+
+// kernel of the production profiles, nullptr for the kiss_fft path: the
+// default 12 channels at 1000 Hz, and its two halves in full duplex, see
+// Config::DuplexOption
+inline std::unique_ptr<OFDMKernel> make_ofdm_kernel(
+    const Config::OFDMOption& opt) {
+  using Full = FixedOFDMKernel<48, 12, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12>;
+  using Low = FixedOFDMKernel<48, 12, 1, 2, 3, 4, 5>;
+  using High = FixedOFDMKernel<48, 12, 8, 9, 10, 11, 12>;
+  if (Full::matches(opt)) {
+    return std::make_unique<Full>();
+  }
+  if (Low::matches(opt)) {
+    return std::make_unique<Low>();
+  }
+  if (High::matches(opt)) {
+    return std::make_unique<High>();
+  }
+  return nullptr;
+}
+
 class OFDM : public Modulator {
  public:
   const Config::OFDMOption opt;
 
-  OFDM(Config::OFDMOption opt) : opt(opt) {}
+  OFDM(Config::OFDMOption opt) : opt(opt), kernel_(make_ofdm_kernel(opt)) {
+    if (!kernel_) {
+      rows_ = OFDMTable::rows(opt.channels, opt.real_symbol_samples);
+    }
+  }
+
+  // whether a FixedOFDMKernel serves this profile
+  bool fixed_kernel() const { return kernel_ != nullptr; }
 
   size_t phy_payload_size(size_t bin_payload_size) const override {
     return opt.phy_payload_size(bin_payload_size);
   }
   size_t symbol_samples() const override { return opt.symbol_samples; }
   size_t bits_per_symbol() const override { return opt.channels.size(); }
+  // power is split among channels
+  float min_snr_db() const override {
+    return 10.0f + 10.0f * std::log10((float)opt.channels.size());
+  }
+  // channels, with half a spacing on each side
+  Band band() const override {
+    auto [low, high] =
+        std::minmax_element(opt.channels.begin(), opt.channels.end());
+    return {(*low - 0.5f) * opt.symbol_freq, (*high + 0.5f) * opt.symbol_freq};
+  }
 
   Samples modulate(Bits bits) override {
     if (bits.size() % opt.channels.size() != 0) {
@@ -38,43 +206,26 @@ class OFDM : public Modulator {
       throw std::runtime_error("Invalid bits size");
     }
 
-    auto cfg = kiss_fft_alloc(opt.real_symbol_samples, 1, 0, 0);
-    std::vector<kiss_fft_cpx> in(opt.real_symbol_samples),
-        out(opt.real_symbol_samples);
-
     Samples wave;
     wave.resize(bits.size() / opt.channels.size() * opt.symbol_samples);
-    for (size_t i = 0; i < bits.size(); i += opt.channels.size()) {
-      auto cur_bits = BitView(bits).subspan(i, opt.channels.size());
-
-      // reset in
-      for (int j = 0; j < opt.real_symbol_samples; j++) {
-        in[j].r = 0;
-        in[j].i = 0;
-      }
-
-      float A = 0.5f / opt.channels.size();
-      for (size_t j = 0; j < opt.channels.size(); j++) {
-        auto channel = opt.channels[j];
-        if (cur_bits[j]) {
-          // one => sin wave
-          in[channel].i = -A;
-          in[opt.real_symbol_samples - channel].i = A;
-        } else {
-          // zero => cos wave
-          in[channel].r = A;
-          in[opt.real_symbol_samples - channel].r = A;
-        }
-      }
-
-      kiss_fft(cfg, in.data(), out.data());
+    if (kernel_) {
+      kernel_->modulate(bits, wave);
+      return wave;
+    }
 
+    // the rows of each group summed, see OFDMTable
+    auto channels = opt.channels.size();
+    auto n = (size_t)opt.real_symbol_samples;
+    for (size_t i = 0; i < bits.size(); i += channels) {
       auto cur_wave = MutSampleView(wave).subspan(
-          i / opt.channels.size() * opt.symbol_samples, opt.symbol_samples);
-      auto core_wave =
-          cur_wave.subspan(opt.cp_samples, opt.real_symbol_samples);
-      for (int j = 0; j < opt.real_symbol_samples; j++) {
-        core_wave[j] = out[j].r;
+          i / channels * opt.symbol_samples, opt.symbol_samples);
+      auto core_wave = cur_wave.subspan(opt.cp_samples, n);
+      for (size_t g = 0; g < OFDMTable::groups(channels); g++) {
+        auto p = OFDMTable::pattern(bits.data() + i, channels, g);
+        auto* row = rows_.data() + (g * OFDMTable::ROWS + p) * n;
+        for (size_t j = 0; j < n; j++) {
+          core_wave[j] += row[j];
+        }
       }
       std::copy(core_wave.end() - opt.cp_samples, core_wave.end(),
                 cur_wave.begin());
@@ -83,17 +234,31 @@ class OFDM : public Modulator {
   }
 
   Bits demodulate(SampleView wave) override {
+    return hard_decision(metrics(wave));
+  }
+
+  Llrs demodulate_soft(SampleView wave) override {
+    return Signal::metrics_to_llrs(metrics(wave));
+  }
+
+  // |sin| - |cos| per channel per symbol
+  Samples metrics(SampleView wave) {
     if (wave.size() % opt.symbol_samples != 0) {
       LOG_ERROR("Invalid wave size: {}", wave.size());
       throw std::runtime_error("Invalid wave size");
     }
+    if (kernel_) {
+      Samples result(wave.size() / opt.symbol_samples * opt.channels.size());
+      kernel_->metrics(wave, result);
+      return result;
+    }
 
     auto cfg = kiss_fft_alloc(opt.real_symbol_samples, 0, 0, 0);
     std::vector<kiss_fft_cpx> in(opt.real_symbol_samples),
         out(opt.real_symbol_samples);
 
-    Bits bits;
-    bits.reserve(wave.size() / opt.symbol_samples * opt.channels.size());
+    Samples result;
+    result.reserve(wave.size() / opt.symbol_samples * opt.channels.size());
     for (size_t i = 0; i < wave.size(); i += opt.symbol_samples) {
       SampleView symbol(wave.begin() + i + opt.cp_samples,
                         opt.real_symbol_samples);
@@ -108,14 +273,19 @@ class OFDM : public Modulator {
         auto channel = opt.channels[j];
         auto one = fabs(out[channel].i);
         auto zero = fabs(out[channel].r);
-        bits.push_back(one > zero);
+        result.push_back(one - zero);
       }
     }
 
     free(cfg);
 
-    return bits;
+    return result;
   }
+
+ private:
+  std::unique_ptr<OFDMKernel> kernel_;
+  // see OFDMTable, without a kernel
+  Samples rows_;
 };
 
 }  // namespace SuperSonic
\ No newline at end of file
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <cmath>
+#include <numbers>
+#include <vector>
+
+#include "config.h"
+#include "log.h"
+#include "magic.h"
+#include "modulator.h"
+#include "utils.h"
+
+namespace SuperSonic {
+
+// Baseband M-PAM with root raised cosine pulses, for cables.
+// Levels are Gray coded and spread evenly over [-1, 1]. The pulse spans
+// opt.span symbols, its tails are sent before the first and after the last
+// symbol, so a frame has span extra symbols. demodulate is the matched
+// filter sampled at the symbol instants: with raised cosine end to end,
+// neighbouring symbols do not interfere.
+class PAM : public Modulator {
+ public:
+  const Config::PAMOption opt;
+
+  PAM(Config::PAMOption opt) : opt(opt) {
+    if (!(opt.levels == 2 || opt.levels == 4 || opt.levels == 8) ||
+        opt.symbol_samples < 2 || opt.span < 2 || opt.span % 2 != 0) {
+      LOG_ERROR("Invalid PAM option: levels {} symbol_samples {} span {}",
+                opt.levels, opt.symbol_samples, opt.span);
+      throw std::runtime_error("Invalid PAM option");
+    }
+    bits_ = (size_t)std::log2(opt.levels);
+    pulse_ = rrc_pulse(opt.rolloff, opt.symbol_samples, opt.span);
+    // the gray code of i is at the i-th level from the bottom
+    levels_.resize(opt.levels);
+    for (int i = 0; i < opt.levels; i++) {
+      levels_[i ^ (i >> 1)] = (2.0f * i - (opt.levels - 1)) / (opt.levels - 1);
+    }
+  }
+
+  size_t phy_payload_size(size_t bin_payload_size) const override {
+    auto symbols = (bin_payload_size + bits_ - 1) / bits_;
+    return (symbols + opt.span) * opt.symbol_samples;
+  }
+  size_t symbol_samples() const override { return opt.symbol_samples; }
+  size_t bits_per_symbol() const override { return bits_; }
+  // levels are closer than antipodal by (levels^2 - 1) / 3 in power
+  float min_snr_db() const override {
+    return 10.0f + 10.0f * std::log10((opt.levels * opt.levels - 1) / 3.0f);
+  }
+  Band band() const override {
+    return {0.0f,
+            (1 + opt.rolloff) * kSampleRate / (2.0f * opt.symbol_samples)};
+  }
+
+  Samples modulate(Bits bits) override {
+    if (bits.size() % bits_ != 0) {
+      LOG_ERROR("Invalid bits size: {}", bits.size());
+      throw std::runtime_error("Invalid bits size");
+    }
+    auto symbols = bits.size() / bits_;
+    auto sps = (size_t)opt.symbol_samples;
+    Samples wave(phy_payload_size(bits.size()));
+    for (size_t k = 0; k < symbols; k++) {
+      auto a = levels_[bits2Int(BitView(bits).subspan(k * bits_, bits_))];
+      // pulse of symbol k starts span / 2 symbols before its instant
+      auto* out = wave.data() + k * sps;
+      for (size_t j = 0; j < pulse_.size(); j++) {
+        out[j] += a * pulse_[j];
+      }
+    }
+    return wave;
+  }
+
+  Bits demodulate(SampleView wave) override {
+    return hard_decision(demodulate_soft(wave));
+  }
+
+  // max-log llrs of each bit, from the distance to the nearest level with
+  // the bit 0 and with the bit 1
+  Llrs demodulate_soft(SampleView wave) override {
+    auto z = matched(wave);
+    if (z.empty()) {
+      return {};
+    }
+    auto gain = estimate_gain(z);
+
+    float var = 0.0f;
+    for (auto& e : z) {
+      e /= gain;
+      auto d = e - levels_[nearest(e)];
+      var += d * d;
+    }
+    var = std::max(var / z.size(), 1e-6f);
+
+    Llrs llrs;
+    llrs.reserve(z.size() * bits_);
+    for (auto e : z) {
+      for (size_t b = 0; b < bits_; b++) {
+        // lsb first, as bits2Int reads them
+        float d0 = INFINITY, d1 = INFINITY;
+        for (int i = 0; i < opt.levels; i++) {
+          auto d = (e - levels_[i]) * (e - levels_[i]);
+          if ((i >> b) & 1) {
+            d1 = std::min(d1, d);
+          } else {
+            d0 = std::min(d0, d);
+          }
+        }
+        llrs.push_back((d0 - d1) / (2 * var));
+      }
+    }
+    return llrs;
+  }
+
+ private:
+  // matched filter output at each symbol instant
+  Samples matched(SampleView wave) const {
+    auto sps = (size_t)opt.symbol_samples;
+    if (wave.size() % sps != 0 || wave.size() / sps < (size_t)opt.span) {
+      LOG_ERROR("Invalid wave size: {}", wave.size());
+      return {};
+    }
+    auto symbols = wave.size() / sps - opt.span;
+    Samples z(symbols);
+    for (size_t k = 0; k < symbols; k++) {
+      z[k] = Signal::dot(wave.subspan(k * sps, pulse_.size()),
+                         SampleView{pulse_});
+    }
+    return z;
+  }
+
+  // the channel scales the levels, fit it from the rms, then refine it on
+  // the decisions
+  float estimate_gain(SampleView z) const {
+    float power = 0.0f, level_power = 0.0f;
+    for (auto e : z) {
+      power += e * e;
+    }
+    for (auto l : levels_) {
+      level_power += l * l;
+    }
+    auto gain = std::sqrt(power / z.size() / (level_power / opt.levels));
+    if (gain <= 0) {
+      return 1.0f;
+    }
+    float zl = 0.0f, ll = 0.0f;
+    for (auto e : z) {
+      auto l = levels_[nearest(e / gain)];
+      zl += e * l;
+      ll += l * l;
+    }
+    return ll > 0 ? zl / ll : gain;
+  }
+
+  // index (bits) of the level nearest to e
+  size_t nearest(float e) const {
+    size_t best = 0;
+    for (size_t i = 1; i < levels_.size(); i++) {
+      if (std::abs(e - levels_[i]) < std::abs(e - levels_[best])) {
+        best = i;
+      }
+    }
+    return best;
+  }
+
+  // root raised cosine, span symbols of sps samples plus one, scaled so
+  // that the wave stays within [-1, 1]
+  static Samples rrc_pulse(float beta, int sps, int span) {
+    auto pi = std::numbers::pi_v<float>;
+    Samples pulse(span * sps + 1);
+    for (size_t i = 0; i < pulse.size(); i++) {
+      auto t = ((float)i - span * sps / 2) / sps;
+      float p;
+      if (t == 0) {
+        p = 1 - beta + 4 * beta / pi;
+      } else if (beta > 0 && std::abs(std::abs(t) - 1 / (4 * beta)) < 1e-6f) {
+        p = beta / std::sqrt(2.0f) *
+            ((1 + 2 / pi) * std::sin(pi / (4 * beta)) +
+             (1 - 2 / pi) * std::cos(pi / (4 * beta)));
+      } else {
+        p = (std::sin(pi * t * (1 - beta)) +
+             4 * beta * t * std::cos(pi * t * (1 + beta))) /
+            (pi * t * (1 - 16 * beta * beta * t * t));
+      }
+      pulse[i] = p;
+    }
+    // worst case: every overlapping pulse at a full level, same sign
+    float peak = 0.0f;
+    for (int j = 0; j < sps; j++) {
+      float sum = 0.0f;
+      for (size_t i = j; i < pulse.size(); i += sps) {
+        sum += std::abs(pulse[i]);
+      }
+      peak = std::max(peak, sum);
+    }
+    for (auto& p : pulse) {
+      p /= peak;
+    }
+    return pulse;
+  }
+
+  size_t bits_;
+  Samples pulse_;
+  std::vector<float> levels_;
+};
+
+}  // namespace SuperSonic
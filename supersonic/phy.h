@@ -9,6 +9,14 @@
 #include <boost/asio/steady_timer.hpp>
 #include <boost/asio/write.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+
 using boost::asio::awaitable;
 using boost::asio::detached;
 using boost::asio::steady_timer;
@@ -20,11 +28,26 @@ namespace this_coro = boost::asio::this_coro;
 #endif
 
 #include "ask.h"
+#include "agc.h"
+#include "burst.h"
+#include "cfar.h"
 #include "chirp.h"
+#include "css.h"
+#include "dsss.h"
+#include "filter.h"
+#include "fsk.h"
 #include "log.h"
 #include "modulator.h"
 #include "ofdm.h"
+#include "pam.h"
+#include "phy_mode.h"
+#include "psk.h"
+#include "resample.h"
+#include "rs.h"
+#include "scrambler.h"
+#include "stream.h"
 #include "supersonic.h"
+#include "timing.h"
 #include "utils.h"
 
 namespace SuperSonic {
@@ -36,16 +59,175 @@ class Sphy {
   static constexpr auto RX_POLL_INTERVAL = std::chrono::milliseconds(0);
   static constexpr auto TIMEOUT = std::chrono::seconds(1);
 
-  // buffer
-  static constexpr size_t TX_BUFFER_SIZE = 0;
-  // chirp
-  const std::vector<float> chirp = Signal::generate_chirp1();
-
-  Sphy(Config::SphyOption opt) : opt_(opt), ofdm_(opt.ofdm_option) {
+  // rx front end block size
+  static constexpr size_t RX_BLOCK_SIZE = 256;
+  // skew estimate update per frame, scaled down for short frames
+  static constexpr double SKEW_GAIN = 0.5;
+  static constexpr size_t SKEW_FULL_WEIGHT_SAMPLES = 16384;
+
+  // frames waiting for the tx worker
+  static constexpr size_t TX_PIPELINE_DEPTH = 16;
+  // modulated frames in the audio ring, including the one playing
+  static constexpr size_t TX_FRAMES_AHEAD = 2;
+  // audio queued ahead of the playback while streaming, covers the
+  // modulation of the next block
+  static constexpr auto STREAM_AHEAD = std::chrono::milliseconds(50);
+
+  // chirp we listen for, and the one we send. The same but in full duplex,
+  // see chirp_band
+  const std::vector<float> chirp;
+  const std::vector<float> tx_chirp;
+
+  Sphy(Config::SphyOption opt)
+      : chirp(make_chirp(opt, false)),
+        tx_chirp(make_chirp(opt, true)),
+        opt_(opt),
+        cfar_(Signal::dot(chirp, chirp), opt.cfar_factor),
+        tx_mode_(opt.phy_mode) {
     LOG_INFO("chirp len {}", chirp.size());
+
+    // full duplex: OFDM only, each way in its own band
+    auto& duplex = opt_.duplex_option;
+    if (duplex.enabled) {
+      auto upper = duplex.upper.value_or(false);
+      register_modulator(Modulation::OFDM,
+                         std::make_unique<OFDM>(duplex.band_option(
+                             opt_.ofdm_option, !upper)));
+      register_tx_modulator(Modulation::OFDM,
+                            std::make_unique<OFDM>(duplex.band_option(
+                                opt_.ofdm_option, upper)));
+    } else {
+      register_modulator(Modulation::ASK, std::make_unique<ASK>());
+      register_modulator(Modulation::OFDM,
+                         std::make_unique<OFDM>(opt_.ofdm_option));
+      register_modulator(Modulation::PAM,
+                         std::make_unique<PAM>(opt_.pam_option));
+      register_modulator(Modulation::FSK,
+                         std::make_unique<FSK>(opt_.fsk_option));
+      register_modulator(Modulation::DBPSK,
+                         std::make_unique<DPSK>(opt_.dpsk_option, 1));
+      register_modulator(Modulation::DQPSK,
+                         std::make_unique<DPSK>(opt_.dpsk_option, 2));
+      register_modulator(Modulation::CSS,
+                         std::make_unique<CSS>(opt_.css_option));
+      register_modulator(Modulation::DSSS,
+                         std::make_unique<DSSS>(opt_.dsss_option));
+    }
+
+    if (find_modulator(opt_.phy_mode.modulation) == nullptr) {
+      LOG_ERROR("Modulation {} not registered",
+                std::to_underlying(opt_.phy_mode.modulation));
+      throw std::runtime_error("Modulation not registered");
+    }
+    set_rx_band({opt_.phy_mode.modulation});
   }
 
-  // Phy frame: chirp + len + payload + gap
+  // Phy frame: chirp + header + payload + gap
+  // header (see PhyHeader) is always modulated by the modulator of
+  // opt_.phy_mode, payload by the modulator selected in the header.
+  // Frames for another dest are skipped without demodulating the payload,
+  // see set_rx_filter.
+  // With FrameFlags::Burst the payload holds several frames, see burst.h
+  // With FrameFlags::Stream len counts blocks of bin_payload_size bits,
+  // each sent as sync word + coded block, see stream.h
+
+  void register_modulator(Modulation modulation,
+                          std::unique_ptr<Modulator> modulator) {
+    auto idx = std::to_underlying(modulation);
+    if (modulators_.size() <= idx) {
+      modulators_.resize(idx + 1);
+    }
+    modulators_[idx] = std::move(modulator);
+  }
+
+  // modulator of our own frames where it differs from the receiving one,
+  // see find_tx_modulator
+  void register_tx_modulator(Modulation modulation,
+                             std::unique_ptr<Modulator> modulator) {
+    auto idx = std::to_underlying(modulation);
+    if (tx_modulators_.size() <= idx) {
+      tx_modulators_.resize(idx + 1);
+    }
+    tx_modulators_[idx] = std::move(modulator);
+  }
+
+  Modulator* find_modulator(Modulation modulation) const {
+    auto idx = std::to_underlying(modulation);
+    if (idx >= modulators_.size()) {
+      return nullptr;
+    }
+    return modulators_[idx].get();
+  }
+
+  Modulator* find_tx_modulator(Modulation modulation) const {
+    auto idx = std::to_underlying(modulation);
+    if (idx < tx_modulators_.size() && tx_modulators_[idx]) {
+      return tx_modulators_[idx].get();
+    }
+    return find_modulator(modulation);
+  }
+
+  Modulator& header_modulator() const {
+    return *find_modulator(opt_.phy_mode.modulation);
+  }
+
+  // design the capture filter for the chirp, the header and payloads of
+  // the given modulations. Full duplex always filters, our own band is far
+  // louder than the peer's
+  void set_rx_band(const std::vector<Modulation>& modulations) {
+    if (!opt_.rx_band_filter && !opt_.duplex_option.enabled) {
+      return;
+    }
+    auto band = chirp_band(opt_, false);
+    auto add = [&](const Modulator& modulator) {
+      band.low = std::min(band.low, modulator.band().low);
+      band.high = std::max(band.high, modulator.band().high);
+    };
+    add(header_modulator());
+    for (auto modulation : modulations) {
+      if (auto* modulator = find_modulator(modulation)) {
+        add(*modulator);
+      }
+    }
+    band_filter_.emplace(band);
+    LOG_INFO("Rx band {} - {} Hz, low-pass {}, high-pass {}", band.low,
+             band.high, band_filter_->lowpass(), band_filter_->highpass());
+  }
+
+  // band of the chirp we send (tx) or listen for: chirp1, or in full duplex
+  // a sweep over the OFDM channels of that way
+  static Band chirp_band(const Config::SphyOption& opt, bool tx) {
+    auto& duplex = opt.duplex_option;
+    if (!duplex.enabled) {
+      return {Signal::CHIRP1_F0, Signal::CHIRP1_F1};
+    }
+    auto upper = duplex.upper.value_or(false) == tx;
+    return OFDM(duplex.band_option(opt.ofdm_option, upper)).band();
+  }
+
+  static std::vector<float> make_chirp(const Config::SphyOption& opt,
+                                       bool tx) {
+    if (!opt.duplex_option.enabled) {
+      return Signal::generate_chirp1();
+    }
+    auto band = chirp_band(opt, tx);
+    return Signal::generate_chirp(band.low, (band.high - band.low) * 1000,
+                                  0.001f);
+  }
+
+  // only receive frames sent to addr or broadcast
+  void set_rx_filter(uint8_t addr) { rx_filter_ = addr; }
+  void clear_rx_filter() { rx_filter_ = std::nullopt; }
+
+  PhyMode tx_mode() const { return tx_mode_; }
+  void set_tx_mode(PhyMode mode) {
+    if (find_modulator(mode.modulation) == nullptr) {
+      LOG_ERROR("Modulation {} not registered",
+                std::to_underlying(mode.modulation));
+      throw std::runtime_error("Modulation not registered");
+    }
+    tx_mode_ = mode;
+  }
 
   std::vector<Samples> frames;
   std::vector<Samples> recv_frames;
@@ -76,33 +258,191 @@ class Sphy {
     }
     auto ex = co_await this_coro::executor;
 
-    tx_channel_ = std::make_unique<TxChannel>(ex, TX_BUFFER_SIZE);
-
     using namespace Signal;
     auto t = linspace(0, .5, kSampleRate / 2);
     auto wave = sine_wave(440, t);
     co_await send_audio(wave);
     co_await send_audio(zeros(kSampleRate / 2));
 
-    // spawn async_main
-    co_spawn(ex, async_main(), detached);
+    // from now on, only the tx worker pushes to supersonic_->tx_buffer
+    tx_thread_ = std::jthread([this](std::stop_token stoken) {
+      tx_worker(stoken);
+    });
+  }
+
+  // empty bits with completed set marks the end of the preceding frames
+  struct TxRequest {
+    Bits bits;
+    PhyMode mode;
+    std::atomic_flag* completed = nullptr;
+    // send bits with send_stream
+    bool stream = false;
+    uint8_t dest = PhyHeader::broadcast;
+  };
+
+  struct RxFrame {
+    PhyMode mode;
+    uint8_t flags;
+    size_t len;
+    // payload_size samples from the fractional position offset,
+    // followed by some slack for clock drift
+    Samples payload;
+    size_t payload_size;
+    double offset;
+  };
+
+  // llrs of the coded bits, before fec
+  struct SoftFrame {
+    PhyMode mode;
+    uint8_t flags;
+    size_t len;
+    Llrs llrs;
+  };
+
+  struct RxStats {
+    PhyMode mode;
+    float snr_db = 0.0f;
+    // sample clock drift measured over the payload, including the
+    // skew already corrected by the resampler
+    float drift_ppm = 0.0f;
+  };
+  const RxStats& last_rx_stats() const { return last_rx_stats_; }
+  // preambles detected, and those dropped for a bad header
+  size_t rx_detections() const { return rx_detections_; }
+  size_t rx_false_alarms() const { return rx_false_alarms_; }
+  // frames skipped by the rx filter
+  size_t rx_filtered() const { return rx_filtered_; }
+
+  std::vector<Modulation> modulations() const {
+    std::vector<Modulation> result;
+    for (size_t i = 0; i < modulators_.size(); i++) {
+      if (modulators_[i]) {
+        result.push_back(static_cast<Modulation>(i));
+      }
+    }
+    return result;
+  }
+
+  // decision-directed SNR: fit a remodulation of the decisions to the wave
+  static float estimate_snr_db(Modulator& modulator,
+                               SampleView wave,
+                               const Bits& bits) {
+    using Signal::dot;
+    auto ref = modulator.modulate(bits);
+    if (ref.size() != wave.size()) {
+      return 0.0f;
+    }
+    auto ref_energy = dot(SampleView{ref}, SampleView{ref});
+    if (ref_energy <= 0.0f) {
+      return 0.0f;
+    }
+    auto gain = dot(wave, SampleView{ref}) / ref_energy;
+    float noise_energy = 0.0f;
+    for (size_t i = 0; i < wave.size(); i++) {
+      auto e = wave[i] - gain * ref[i];
+      noise_energy += e * e;
+    }
+    noise_energy = std::max(noise_energy, 1e-12f);
+    return 10.0f * std::log10(gain * gain * ref_energy / noise_energy);
   }
 
-  using TxChannel =
-      boost::asio::experimental::channel<void(boost::system::error_code, Bits)>;
+  // pad bits to a multiple of bits_per_symbol
+  static Bits pad_bits(Bits bits, size_t bits_per_symbol) {
+    bits.resize((bits.size() + bits_per_symbol - 1) / bits_per_symbol *
+                bits_per_symbol);
+    return bits;
+  }
 
-  static constexpr int len_samples = 14;
+  // samples of a field of bits, including what the modulator adds around
+  // the symbols (pulse tails)
+  static size_t field_samples(const Modulator& modulator, size_t bits) {
+    return modulator.phy_payload_size(bits);
+  }
+
+  static size_t coded_size(Coding coding, size_t len) {
+    switch (coding) {
+      case Coding::RS1511:
+        return RS1511::encoded_size(len);
+      default:
+        return len;
+    }
+  }
+
+  Bits encode(Coding coding, Bits bits) {
+    switch (coding) {
+      case Coding::RS1511:
+        return tx_rs_.encode_many(bits);
+      default:
+        return bits;
+    }
+  }
+
+  Bits decode(Coding coding, Bits bits, size_t len) {
+    bits.resize(coded_size(coding, len));
+    switch (coding) {
+      case Coding::RS1511:
+        bits = rx_rs_.decode_many(bits);
+        break;
+      default:
+        break;
+    }
+    bits.resize(len);
+    return bits;
+  }
 
   awaitable<Bits> rx() {
-    auto phy_payload = co_await receive_frame();
+    // rest of the last burst
+    if (!rx_pending_.empty()) {
+      auto bits = std::move(rx_pending_.front());
+      rx_pending_.pop_front();
+      co_return bits;
+    }
+
+    auto frame = co_await rx_soft();
+    if (frame.llrs.empty()) {
+      co_return Bits{};
+    }
+    auto raw_bits =
+        decode(frame.mode.coding, hard_decision(frame.llrs), frame.len);
+
+    if (frame.flags & FrameFlags::Burst) {
+      auto sub_frames = Burst::unpack(raw_bits, opt_.max_payload_size);
+      LOG_INFO("Sphy Received burst of {} frames, {} bits", sub_frames.size(),
+               raw_bits.size());
+      if (sub_frames.empty()) {
+        co_return Bits{};
+      }
+      rx_pending_.insert(rx_pending_.end(),
+                         std::make_move_iterator(sub_frames.begin() + 1),
+                         std::make_move_iterator(sub_frames.end()));
+      co_return std::move(sub_frames.front());
+    }
+
+    LOG_INFO("Sphy Received {} bits", raw_bits.size());
+    co_return raw_bits;
+  }
+
+  awaitable<SoftFrame> rx_soft() {
+    if (stream_.blocks_left > 0) {
+      co_return co_await rx_stream_block();
+    }
+
+    auto frame = co_await receive_frame();
+
+    if (frame.flags & FrameFlags::Stream) {
+      LOG_INFO("Stream of {} blocks", frame.len);
+      stream_ = Stream::State{frame.mode, frame.len, std::move(frame.payload),
+                              frame.offset};
+      stream_.flags = frame.flags;
+      co_return co_await rx_stream_block();
+    }
 
-    recv_frames.push_back(phy_payload);
+    recv_frames.push_back(frame.payload);
 
-    auto len_size = len_samples * modulator_->symbol_samples();
-    auto len_wave =
-        SampleView{phy_payload.begin(), phy_payload.begin() + len_size};
-    auto payload_wave =
-        SampleView{phy_payload.begin() + len_size, phy_payload.end()};
+    auto& modulator = *find_modulator(frame.mode.modulation);
+    auto aligned = Signal::fractional_resample(frame.payload, frame.offset, 1.0,
+                                               frame.payload_size);
+    auto payload_wave = SampleView{aligned};
 
     float payload_wave_energy = 0.0f;
     for (size_t i = 0; i < payload_wave.size(); i++) {
@@ -111,29 +451,101 @@ class Sphy {
     float payload_wave_power = payload_wave_energy / payload_wave.size();
     LOG_INFO("Payload wave power: {}", payload_wave_power);
 
-    auto len_bits = modulator_->demodulate(len_wave);
-    auto len = bits2Int(len_bits);
-
+    auto len = frame.len;
     if (!(1 <= len && len <= opt_.max_payload_size)) {
-      co_return Bits{};
+      co_return SoftFrame{frame.mode, frame.flags, len, {}};
+    }
+
+    if (!opt_.timing_tracking) {
+      auto llrs = modulator.demodulate_soft(payload_wave);
+      last_rx_stats_ = {frame.mode, estimate_snr_db(modulator, payload_wave,
+                                                    hard_decision(llrs))};
+      descramble(frame.flags, llrs);
+      co_return SoftFrame{frame.mode, frame.flags, len, std::move(llrs)};
     }
 
-    auto raw_bits = modulator_->demodulate(payload_wave);
-    raw_bits.resize(len);
+    auto tracked =
+        TimingTracker::demodulate(modulator, frame.payload, frame.payload_size,
+                                  frame.offset);
+    auto& llrs = tracked.llrs;
+    last_rx_stats_ = {
+        frame.mode,
+        estimate_snr_db(modulator, tracked.wave, hard_decision(llrs)),
+        (float)(tracked.drift * 1e6 + skew_ppm_),
+    };
+    LOG_INFO("Timing offset {} samples at frame end, drift {} ppm",
+             tracked.offset, last_rx_stats_.drift_ppm);
+    if (opt_.skew_correction) {
+      update_skew(tracked.drift, frame.payload_size);
+    }
 
-    LOG_INFO("Sphy Received {} bits", raw_bits.size());
-    // for (size_t i = 0; i < raw_bits.size(); i++) {
-    //   printf("%d", raw_bits[i]);
-    // }
-    // printf("\n");
+    descramble(frame.flags, llrs);
+    co_return SoftFrame{frame.mode, frame.flags, len, std::move(llrs)};
+  }
 
-    co_return raw_bits;
+  // next block of the stream being received, llrs empty if the lock is lost
+  awaitable<SoftFrame> rx_stream_block() {
+    auto& modulator = *find_modulator(stream_.mode.modulation);
+    auto block_bits = opt_.bin_payload_size;
+    auto sync_wave = modulator.modulate(
+        pad_bits(Stream::sync_word, modulator.bits_per_symbol()));
+    auto payload_size = modulator.phy_payload_size(
+        coded_size(stream_.mode.coding, block_bits));
+
+    auto need = Stream::samples_needed(stream_, sync_wave.size() + payload_size,
+                                       opt_.max_clock_drift_ppm,
+                                       opt_.frame_gap_size);
+    while (stream_.wave.size() < need) {
+      stream_.wave.push_back(co_await rx_pop());
+    }
+
+    auto block =
+        Stream::demodulate_block(modulator, sync_wave, payload_size,
+                                 opt_.max_clock_drift_ppm, stream_);
+    auto mode = stream_.mode;
+    auto flags = stream_.flags;
+    if (block.llrs.empty()) {
+      LOG_WARN("Stream lock lost, {} blocks dropped", stream_.blocks_left);
+      end_stream();
+      co_return SoftFrame{mode, flags, block_bits, {}};
+    }
+    stream_.blocks_left--;
+
+    last_rx_stats_ = {
+        mode,
+        estimate_snr_db(modulator, block.wave, hard_decision(block.llrs)),
+        (float)(stream_.drift * 1e6 + skew_ppm_),
+    };
+
+    if (stream_.blocks_left == 0) {
+      end_stream();
+    }
+    descramble(flags, block.llrs);
+    co_return SoftFrame{mode, flags, block_bits, std::move(block.llrs)};
+  }
+
+  // undo the scrambler of the sender, on the llrs of one frame or block
+  static void descramble(uint8_t flags, Llrs& llrs) {
+    if (flags & FrameFlags::Scrambled) {
+      Scrambler().apply(llrs);
+    }
+  }
+
+  void end_stream() {
+    if (opt_.skew_correction && stream_.samples > 0) {
+      update_skew(stream_.drift, stream_.samples);
+    }
+    stream_ = Stream::State{};
   }
 
-  awaitable<void> tx(Bits bits) {
-    if (tx_channel_ == nullptr) {
-      LOG_ERROR("Tx channel not initialized. This should not happen.");
-      throw std::runtime_error("Tx channel not initialized");
+  awaitable<void> tx(Bits bits) { co_await tx(std::move(bits), tx_mode_); }
+
+  awaitable<void> tx(Bits bits,
+                     PhyMode mode,
+                     uint8_t dest = PhyHeader::broadcast) {
+    if (!tx_thread_.joinable()) {
+      LOG_ERROR("Tx worker not initialized. This should not happen.");
+      throw std::runtime_error("Tx worker not initialized");
       co_return;
     }
     if (!(1 <= bits.size() && bits.size() <= opt_.max_payload_size)) {
@@ -147,12 +559,78 @@ class Sphy {
     // }
     // printf("\n");
 
-    co_await tx_channel_->async_send({}, std::move(bits));
+    co_await tx_enqueue(TxRequest{std::move(bits), mode, nullptr, false, dest});
+  }
+
+  // one long frame for bulk transfers: bits are cut in bin_payload_size
+  // blocks sent back to back, without preamble or gap in between
+  awaitable<void> tx_stream(Bits bits) {
+    co_await tx_stream(std::move(bits), tx_mode_);
+  }
+
+  awaitable<void> tx_stream(Bits bits, PhyMode mode) {
+    if (!tx_thread_.joinable()) {
+      LOG_ERROR("Tx worker not initialized. This should not happen.");
+      throw std::runtime_error("Tx worker not initialized");
+    }
+    if (bits.empty()) {
+      LOG_ERROR("Invalid bits size: {}", bits.size());
+      throw std::runtime_error("Invalid bits size");
+    }
+    co_await tx_enqueue(TxRequest{std::move(bits), mode, nullptr, true});
+  }
+
+  // several frames queued together, the worker sends them as one burst as
+  // far as max_burst_ms and max_payload_size allow
+  awaitable<void> tx(std::vector<Bits> frames,
+                     PhyMode mode,
+                     uint8_t dest = PhyHeader::broadcast) {
+    if (!tx_thread_.joinable()) {
+      LOG_ERROR("Tx worker not initialized. This should not happen.");
+      throw std::runtime_error("Tx worker not initialized");
+    }
+    std::vector<TxRequest> requests;
+    for (auto& bits : frames) {
+      if (!(1 <= bits.size() && bits.size() <= opt_.max_payload_size)) {
+        LOG_ERROR("Invalid bits size: {}", bits.size());
+        throw std::runtime_error("Invalid bits size");
+      }
+      requests.push_back(
+          TxRequest{std::move(bits), mode, nullptr, false, dest});
+    }
+    co_await tx_enqueue(std::move(requests));
+  }
+
+  awaitable<void> tx_enqueue(TxRequest request) {
+    std::vector<TxRequest> requests;
+    requests.push_back(std::move(request));
+    co_await tx_enqueue(std::move(requests));
+  }
+
+  // wait for space in the pipeline, then queue all requests under one lock,
+  // the worker modulates in order
+  awaitable<void> tx_enqueue(std::vector<TxRequest> requests) {
+    steady_timer timer(co_await this_coro::executor);
+    while (true) {
+      {
+        std::lock_guard lock(tx_mutex_);
+        if (tx_queue_.empty() ||
+            tx_queue_.size() + requests.size() <= TX_PIPELINE_DEPTH) {
+          for (auto& request : requests) {
+            tx_queue_.push_back(std::move(request));
+          }
+          break;
+        }
+      }
+      timer.expires_after(PUSH_INTERVAL);
+      co_await timer.async_wait(use_awaitable);
+    }
+    tx_cv_.notify_one();
   }
 
   awaitable<void> tx_finish() {
     std::atomic_flag completed = ATOMIC_FLAG_INIT;
-    supersonic_->tx_buffer.push({{}, &completed});
+    co_await tx_enqueue(TxRequest{{}, tx_mode_, &completed});
 
     static constexpr int spin_interval = 2;
 
@@ -170,61 +648,285 @@ class Sphy {
     co_await tx(Bits{bits.begin(), bits.end()});
   }
 
-  // called by init
-  awaitable<void> async_main() {
-    // handling tx
-    if (!tx_channel_) {
-      LOG_ERROR("Tx channel not initialized. This should not happen.");
-      throw std::runtime_error("Tx channel not initialized");
-      co_return;
+  // runs in tx_thread_: modulate the next frame while the current one plays.
+  // Requests queued meanwhile are sent as one burst.
+  void tx_worker(std::stop_token stoken) {
+    LOG_INFO("Sphy tx worker started");
+    while (true) {
+      while (tx_frames_ahead() >= TX_FRAMES_AHEAD) {
+        if (stoken.stop_requested()) {
+          return;
+        }
+        std::this_thread::sleep_for(PUSH_INTERVAL);
+      }
+
+      std::vector<TxRequest> requests;
+      {
+        std::unique_lock lock(tx_mutex_);
+        if (!tx_cv_.wait(lock, stoken, [&] { return !tx_queue_.empty(); })) {
+          return;
+        }
+        requests.push_back(std::move(tx_queue_.front()));
+        tx_queue_.pop_front();
+        while (!tx_queue_.empty() && can_burst(requests, tx_queue_.front())) {
+          requests.push_back(std::move(tx_queue_.front()));
+          tx_queue_.pop_front();
+        }
+        tx_modulating_ = true;
+      }
+
+      // markers never join a burst
+      auto completed = requests.front().completed;
+      if (requests.front().stream) {
+        send_stream(std::move(requests.front()), stoken);
+      } else {
+        auto frame = build_requests(requests);
+        if (!frame.empty() || completed != nullptr) {
+          push_audio(std::move(frame), completed, stoken);
+        }
+      }
+
+      std::lock_guard lock(tx_mutex_);
+      tx_modulating_ = false;
     }
-    LOG_INFO("Sphy async_main started");
-    while (1) {
-      auto bits = co_await tx_channel_->async_receive(use_awaitable);
-      co_await send_bits(std::move(bits));
+  }
+
+  // blocks are pushed as they are modulated, only STREAM_AHEAD of audio is
+  // queued in front of the playback
+  void send_stream(TxRequest request, std::stop_token stoken) {
+    build_stream(std::move(request), [&](Samples part) {
+      while (tx_queued() > STREAM_AHEAD) {
+        if (stoken.stop_requested()) {
+          return;
+        }
+        std::this_thread::sleep_for(PUSH_INTERVAL);
+      }
+      push_audio(std::move(part), nullptr, stoken);
+    });
+  }
+
+  // the frame for requests popped by tx_worker, empty for a marker, a
+  // stream or on error
+  Samples build_requests(std::vector<TxRequest>& requests) {
+    Samples frame;
+    if (requests.size() > 1) {
+      std::vector<Bits> sub_frames;
+      for (auto& request : requests) {
+        sub_frames.push_back(std::move(request.bits));
+      }
+      LOG_INFO("Sphy Sending burst of {} frames", sub_frames.size());
+      frame = build_frame(TxRequest{Burst::pack(sub_frames),
+                                    requests.front().mode, nullptr, false,
+                                    requests.front().dest},
+                          FrameFlags::Burst);
+    } else if (!requests.front().bits.empty()) {
+      frame = build_frame(std::move(requests.front()));
     }
+    return frame;
   }
 
-  awaitable<void> send_bits(Bits bits) {
-    auto raw_bit_len = bits.size();
+  // frames queued, being modulated or still playing. While true, the
+  // channel is ours and the next frame follows without carrier sense.
+  bool tx_active() {
+    {
+      std::lock_guard lock(tx_mutex_);
+      if (!tx_queue_.empty() || tx_modulating_) {
+        return true;
+      }
+    }
+    return tx_queued().count() > 0;
+  }
 
-    auto bits_per_symbol = modulator_->bits_per_symbol();
+  // audio pushed but not played yet
+  std::chrono::steady_clock::duration tx_queued() const {
+    auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+    return std::chrono::steady_clock::duration(
+        std::max<std::chrono::steady_clock::rep>(tx_busy_until_.load() - now,
+                                                 0));
+  }
 
-    auto max_len = pow(2, len_samples * bits_per_symbol);
-    if (raw_bit_len >= max_len) {
-      LOG_ERROR("Payload len too large: {} > {}", raw_bit_len, max_len);
-      co_return;
+  // tasks in the audio ring, the one playing stays at the front until done
+  size_t tx_frames_ahead() const {
+    return opt_.saudio_option.ringbuffer_size -
+           supersonic_->tx_buffer.write_available();
+  }
+
+  // whether next fits in the burst made of requests
+  bool can_burst(const std::vector<TxRequest>& requests,
+                 const TxRequest& next) const {
+    auto& first = requests.front();
+    if (opt_.max_burst_ms <= 0 || first.bits.empty() || next.bits.empty() ||
+        first.stream || next.stream || next.mode != first.mode ||
+        next.dest != first.dest) {
+      return false;
+    }
+    auto* modulator = find_tx_modulator(first.mode.modulation);
+    if (modulator == nullptr) {
+      return false;
+    }
+
+    size_t len = Burst::packed_size(next.bits.size());
+    for (auto& request : requests) {
+      len += Burst::packed_size(request.bits.size());
+    }
+    if (len > opt_.max_payload_size) {
+      return false;
     }
 
+    auto samples =
+        modulator->phy_payload_size(coded_size(first.mode.coding, len));
+    return samples <= opt_.max_burst_ms * kSampleRate / 1000;
+  }
+
+  void push_audio(Samples data,
+                  std::atomic_flag* completed,
+                  std::stop_token stoken) {
+    while (!supersonic_->tx_buffer.write_available()) {
+      if (stoken.stop_requested()) {
+        return;
+      }
+      std::this_thread::sleep_for(PUSH_INTERVAL);
+    }
+    supersonic_->tx_buffer.push({data, completed});
+
+    // plays after whatever is already in the ring
+    using namespace std::chrono;
+    auto now = steady_clock::now().time_since_epoch().count();
+    auto length = duration_cast<steady_clock::duration>(
+                      duration<double>((double)data.size() / kSampleRate))
+                      .count();
+    tx_busy_until_ = std::max(now, tx_busy_until_.load()) + length;
+  }
+
+  // chirp + header + payload + gap, empty on error
+  Samples build_frame(TxRequest request, uint8_t flags = 0) {
+    auto& bits = request.bits;
+    auto raw_bit_len = bits.size();
+
+    auto* modulator = find_tx_modulator(request.mode.modulation);
+    if (modulator == nullptr) {
+      LOG_ERROR("Modulation {} not registered",
+                std::to_underlying(request.mode.modulation));
+      return {};
+    }
+    auto bits_per_symbol = modulator->bits_per_symbol();
 
-    bits.resize((bits.size() + bits_per_symbol - 1) / bits_per_symbol *
-                bits_per_symbol);
     if (bits.size() > opt_.max_payload_size) {
       LOG_ERROR("Invalid bits size: {}", bits.size());
-      co_return;
+      return {};
     }
 
-    LOG_INFO("Sphy Sending {} bits", bits.size());
+    auto coded_bits =
+        pad_bits(encode(request.mode.coding, std::move(bits)), bits_per_symbol);
+    if (opt_.scramble) {
+      Scrambler().apply(coded_bits);
+      flags |= FrameFlags::Scrambled;
+    }
+
+    LOG_INFO("Sphy Sending {} bits, {} bits after coding", raw_bit_len,
+             coded_bits.size());
 
-    auto len_wave = modulator_->modulate(
-        int2Bits(raw_bit_len, static_cast<int>(len_samples * bits_per_symbol)));
-    auto payload_wave = modulator_->modulate(std::move((bits)));
-    auto wave = Signal::concatenate(len_wave, payload_wave);
+    auto payload_wave = modulator->modulate(std::move(coded_bits));
+    auto wave = Signal::concatenate(
+        header_wave({request.mode, flags, request.dest, raw_bit_len}),
+        payload_wave);
 
     if (wave.size() < 64) {
       LOG_ERROR("Wave size too small: {}", wave.size());
-      throw std::runtime_error("Wave size too small");
+      return {};
     }
 
     frames.push_back(wave);
 
-    co_await send_frame(wave);
+    auto tx_filter = make_tx_filter();
+    auto frame = Signal::concatenate(tx_chirp, wave,
+                                     Signal::zeros(opt_.frame_gap_size));
+    return tx_band_limit(tx_filter, std::move(frame), true);
   }
 
-  awaitable<void> send_frame(SampleView phy_payload) {
-    auto frame = Signal::concatenate(chirp, phy_payload,
-                                     Signal::zeros(opt_.frame_gap_size));
-    co_await send_audio(std::move(frame));
+  // in full duplex our own frames are band-limited to our band, the edges
+  // of the symbols would splatter into the peer's. One filter per frame,
+  // pieces of a frame go through it in order, the last flushes it.
+  std::optional<BandFilter> make_tx_filter() const {
+    if (!opt_.duplex_option.enabled) {
+      return std::nullopt;
+    }
+    return BandFilter(chirp_band(opt_, true));
+  }
+
+  static Samples tx_band_limit(std::optional<BandFilter>& filter,
+                               Samples wave,
+                               bool last) {
+    if (!filter) {
+      return wave;
+    }
+    Samples out;
+    filter->process(wave, out);
+    if (last) {
+      filter->process(Signal::zeros(filter->delay()), out);
+    }
+    return out;
+  }
+
+  Samples header_wave(const PhyHeader::Value& header) {
+    auto& hdr_modulator = *find_tx_modulator(opt_.phy_mode.modulation);
+    return hdr_modulator.modulate(
+        pad_bits(PhyHeader::encode(header), hdr_modulator.bits_per_symbol()));
+  }
+
+  // chirp + header + (sync word + block) * len + gap, handed to emit in
+  // pieces as they are modulated: chirp + header first, then one sync word +
+  // block at a time, the gap with the last one. false on error.
+  template <typename Emit>
+  bool build_stream(TxRequest request, Emit&& emit) {
+    auto* modulator = find_tx_modulator(request.mode.modulation);
+    if (modulator == nullptr) {
+      LOG_ERROR("Modulation {} not registered",
+                std::to_underlying(request.mode.modulation));
+      return false;
+    }
+    auto bits_per_symbol = modulator->bits_per_symbol();
+
+    auto block_bits = opt_.bin_payload_size;
+    auto blocks = (request.bits.size() + block_bits - 1) / block_bits;
+    if (blocks > PhyHeader::max_len) {
+      LOG_ERROR("Too many stream blocks: {} > {}", blocks, PhyHeader::max_len);
+      return false;
+    }
+    request.bits.resize(blocks * block_bits);
+
+    LOG_INFO("Sphy Streaming {} bits in {} blocks", request.bits.size(),
+             blocks);
+
+    uint8_t flags = FrameFlags::Stream;
+    if (opt_.scramble) {
+      flags |= FrameFlags::Scrambled;
+    }
+    auto sync_wave =
+        modulator->modulate(pad_bits(Stream::sync_word, bits_per_symbol));
+    auto tx_filter = make_tx_filter();
+    emit(tx_band_limit(
+        tx_filter,
+        Signal::concatenate(
+            tx_chirp, header_wave({request.mode, flags, request.dest, blocks})),
+        false));
+    for (size_t i = 0; i < blocks; i++) {
+      Bits block(request.bits.begin() + i * block_bits,
+                 request.bits.begin() + (i + 1) * block_bits);
+      auto coded_bits = pad_bits(encode(request.mode.coding, std::move(block)),
+                                 bits_per_symbol);
+      // the sync word is sent as is, each block is scrambled on its own
+      if (opt_.scramble) {
+        Scrambler().apply(coded_bits);
+      }
+      auto wave = Signal::concatenate(
+          sync_wave, modulator->modulate(std::move(coded_bits)));
+      if (i + 1 == blocks) {
+        wave.resize(wave.size() + opt_.frame_gap_size, 0.0f);
+      }
+      emit(tx_band_limit(tx_filter, std::move(wave), i + 1 == blocks));
+    }
+    return true;
   }
 
   awaitable<void> send_audio(Samples data) {
@@ -252,27 +954,94 @@ class Sphy {
     supersonic_->tx_buffer.push({data});
   }
 
+  // drift is what is left after the resampler, integrate it into the skew
+  void update_skew(double drift, size_t payload_size) {
+    auto weight =
+        std::min(1.0, (double)payload_size / SKEW_FULL_WEIGHT_SAMPLES);
+    skew_ppm_ = std::clamp(skew_ppm_ + SKEW_GAIN * weight * drift * 1e6,
+                           -(double)opt_.max_clock_drift_ppm,
+                           (double)opt_.max_clock_drift_ppm);
+    resampler_.set_step(1.0 + skew_ppm_ * 1e-6);
+  }
+
   awaitable<float> rx_pop() {
     rx_samples_++;
 
     // fast path
-    if (supersonic_->rx_buffer.read_available()) {
-      float e;
-      supersonic_->rx_buffer.pop(e);
-      co_return (opt_.magic_factor * e);
+    if (rx_block_idx_ < rx_block_.size()) {
+      co_return rx_block_[rx_block_idx_++];
     }
 
-    while (!supersonic_->rx_buffer.read_available()) {
-      steady_timer timer(co_await this_coro::executor);
-      timer.expires_after(RX_POLL_INTERVAL);
-      co_await timer.async_wait(use_awaitable);
+    co_await rx_refill();
+    co_return rx_block_[rx_block_idx_++];
+  }
+
+  // drop n samples
+  awaitable<void> rx_skip(size_t n) {
+    while (n > 0) {
+      if (rx_block_idx_ == rx_block_.size()) {
+        co_await rx_refill();
+      }
+      auto k = std::min(n, rx_block_.size() - rx_block_idx_);
+      rx_block_idx_ += k;
+      rx_samples_ += k;
+      n -= k;
+    }
+  }
+
+  // give samples back, rx_pop returns them again in order
+  void rx_unread(std::span<const float> samples) {
+    Samples block(samples.begin(), samples.end());
+    block.insert(block.end(), rx_block_.begin() + rx_block_idx_,
+                 rx_block_.end());
+    rx_block_ = std::move(block);
+    rx_block_idx_ = 0;
+    rx_samples_ -= samples.size();
+  }
+
+  // move captured samples through the rx front end into rx_block_
+  awaitable<void> rx_refill() {
+    rx_block_.clear();
+    rx_block_idx_ = 0;
+    while (rx_block_.empty()) {
+      while (!supersonic_->rx_buffer.read_available()) {
+        steady_timer timer(co_await this_coro::executor);
+        timer.expires_after(RX_POLL_INTERVAL);
+        co_await timer.async_wait(use_awaitable);
+      }
+
+      rx_raw_.resize(RX_BLOCK_SIZE);
+      auto n = supersonic_->rx_buffer.pop(rx_raw_.data(), RX_BLOCK_SIZE);
+      rx_raw_.resize(n);
+
+      if (band_filter_) {
+        rx_band_.clear();
+        band_filter_->process(rx_raw_, rx_band_);
+        std::swap(rx_raw_, rx_band_);
+      }
+
+      if (opt_.skew_correction) {
+        resampler_.process(rx_raw_, rx_block_);
+      } else {
+        std::swap(rx_block_, rx_raw_);
+      }
+
+      // after the resampler, a polarity flip takes effect at once
+      if (opt_.magic_factor) {
+        for (auto& e : rx_block_) {
+          e *= *opt_.magic_factor;
+        }
+      } else {
+        // the noise estimate is in the same units as the correlation, it
+        // must not lag behind the gain, e.g. over a skipped frame
+        auto gain = agc_.gain();
+        agc_.process(rx_block_);
+        cfar_.rescale(agc_.gain() / gain);
+      }
     }
-    float e;
-    supersonic_->rx_buffer.pop(e);
-    co_return (opt_.magic_factor * e);
   }
 
-  awaitable<std::vector<float>> receive_frame() {
+  awaitable<RxFrame> receive_frame() {
     using namespace Signal;
 
     static const size_t chirp_len = chirp.size();
@@ -292,69 +1061,206 @@ class Sphy {
     };
 
     auto add_one = [&](float a) {
+      cfar_.update(preamble[0]);
       move_left(preamble);
       preamble[chirp_len - 1] = a;
       move_left(corr);
       corr[PREMABLE_WINDOW_SIZE - 1] = calc_preamble_corr();
     };
 
+    // without a fixed magic_factor the capture may be inverted, the chirp
+    // then shows as a negative peak
+    auto auto_polarity = !opt_.magic_factor.has_value();
+    auto peak = [&](float c) { return auto_polarity ? std::abs(c) : c; };
+
     while (true) {
-      float e = co_await rx_pop();
-      add_one(e);
-      auto max_idx = argmax(corr);
-      if (corr[max_idx] > max_preamble_corr) {
-        max_preamble_corr = corr[max_idx];
-        // LOG_INFO("Max preamble corr: {}", max_preamble_corr);
+      while (true) {
+        float e = co_await rx_pop();
+        add_one(e);
+        auto max_idx = std::max_element(corr.begin(), corr.end(),
+                                        [&](float a, float b) {
+                                          return peak(a) < peak(b);
+                                        }) -
+                       corr.begin();
+        if (peak(corr[max_idx]) > max_preamble_corr) {
+          max_preamble_corr = peak(corr[max_idx]);
+          // LOG_INFO("Max preamble corr: {}", max_preamble_corr);
+        }
+        auto threshold = opt_.cfar_factor > 0
+                             ? cfar_.threshold() / chirp_len
+                             : opt_.preamble_threshold;
+        if (max_idx == PREMABLE_PEEK_SIZE && peak(corr[max_idx]) > threshold) {
+          // preamble found
+          rx_detections_++;
+          LOG_INFO("Preamble found with corr={}, threshold={}", corr[max_idx],
+                   threshold);
+          break;
+        }
       }
-      if (max_idx == PREMABLE_PEEK_SIZE &&
-          corr[max_idx] > opt_.preamble_threshold) {
-        // preamble found
-        LOG_INFO("Preamble found with corr={}", corr[max_idx]);
-        break;
+
+      if (corr[PREMABLE_PEEK_SIZE] < 0) {
+        // inverted capture, flip from here on, including what is buffered
+        agc_.flip_polarity();
+        LOG_WARN("Capture polarity flipped, now {}", agc_.polarity());
+        for (auto* buffer : {&preamble, &corr}) {
+          for (auto& e : *buffer) {
+            e = -e;
+          }
+        }
+        for (size_t i = rx_block_idx_; i < rx_block_.size(); i++) {
+          rx_block_[i] = -rx_block_[i];
+        }
       }
-    }
 
-    std::span<float> peek_wave{preamble.data() + chirp_len - PREMABLE_PEEK_SIZE,
-                               PREMABLE_PEEK_SIZE};
-    Samples phy_payload{peek_wave.begin(), peek_wave.end()};
+      // sub-sample position of the correlation peak
+      double peak_offset = Signal::parabolic_peak(
+          corr[PREMABLE_PEEK_SIZE - 1], corr[PREMABLE_PEEK_SIZE],
+          corr[PREMABLE_PEEK_SIZE + 1]);
+
+      // one sample of history for the interpolation, so phy frame starts
+      // at the fractional position 1 + peak_offset
+      std::span<float> peek_wave{
+          preamble.data() + chirp_len - PREMABLE_PEEK_SIZE - 1,
+          PREMABLE_PEEK_SIZE + 1};
+      Samples phy_payload{peek_wave.begin(), peek_wave.end()};
+      auto start = 1.0 + peak_offset;
+
+      auto read_till = [&](size_t size) -> awaitable<void> {
+        while (phy_payload.size() < size) {
+          phy_payload.push_back(co_await rx_pop());
+        }
+      };
+      // false alarm, search the samples read past the peak again, a real
+      // preamble may start inside them
+      auto rewind = [&]() {
+        rx_unread(std::span<const float>(phy_payload)
+                      .subspan(PREMABLE_PEEK_SIZE + 1));
+      };
+
+      // read till header, a bad one is a false alarm
+      auto& hdr_modulator = header_modulator();
+      auto header_size =
+          field_samples(hdr_modulator, PhyHeader::encoded_bits);
+      co_await read_till(header_size + 3);
+
+      auto header = PhyHeader::decode(hdr_modulator.demodulate(
+          Signal::fractional_resample(phy_payload, start, 1.0, header_size)));
+      if (!header) {
+        rx_false_alarms_++;
+        LOG_WARN("Header crc mismatch, back to preamble search");
+        rewind();
+        continue;
+      }
+      auto [mode, flags, dest, len] = *header;
+      auto* modulator = find_modulator(mode.modulation);
+      if (modulator == nullptr ||
+          std::to_underlying(mode.coding) > std::to_underlying(Coding::RS1511)) {
+        rx_false_alarms_++;
+        LOG_WARN("Invalid mode: modulation {} coding {}, corrupted frame",
+                 std::to_underlying(mode.modulation),
+                 std::to_underlying(mode.coding));
+        rewind();
+        continue;
+      }
 
-    // read till len
-    auto len_size = len_samples * modulator_->symbol_samples();
-    if (phy_payload.size() < len_size) {
-      auto to_read = len_size - phy_payload.size();
-      for (size_t i = 0; i < to_read; i++) {
-        phy_payload.push_back(co_await rx_pop());
+      // blocks are read one by one, see rx_stream_block
+      if (flags & FrameFlags::Stream) {
+        if (len < 1) {
+          rx_false_alarms_++;
+          LOG_WARN("Empty stream, corrupted frame");
+          rewind();
+          continue;
+        }
+        co_return RxFrame{
+            mode, flags, len,
+            Samples{phy_payload.begin() + header_size, phy_payload.end()}, 0,
+            peak_offset + 1.0};
       }
-    }
 
-    auto len_wave =
-        SampleView{phy_payload.begin(), phy_payload.begin() + len_size};
-    auto len_bits = modulator_->demodulate(len_wave);
-    auto len = bits2Int(len_bits);
-    if (!(1 <= len && len <= opt_.max_payload_size)) {
-      LOG_WARN("Invalid len: {}, corrupted frame", len);
-      len = 1;
-    }
+      if (!(1 <= len && len <= opt_.max_payload_size)) {
+        rx_false_alarms_++;
+        LOG_WARN("Invalid len: {}, corrupted frame", len);
+        rewind();
+        continue;
+      }
 
-    auto frame_total_size = len_size + modulator_->phy_payload_size(len);
-    auto to_read = frame_total_size - phy_payload.size();
-    for (size_t i = 0; i < to_read; i++) {
-      phy_payload.push_back(co_await rx_pop());
+      auto payload_size =
+          modulator->phy_payload_size(coded_size(mode.coding, len));
+
+      // not for us, only advance past the payload
+      if (rx_filter_ && dest != PhyHeader::broadcast && dest != *rx_filter_) {
+        rx_filtered_++;
+        // part of the payload may already be in phy_payload
+        auto read = phy_payload.size() - 1 - header_size;
+        co_await rx_skip(payload_size > read ? payload_size - read : 0);
+        std::fill(preamble.begin(), preamble.end(), 0.0f);
+        std::fill(corr.begin(), corr.end(), 0.0f);
+        continue;
+      }
+      // the sender's clock may be slower, read a bit more for the tracker,
+      // but not into the next preamble
+      auto slack = std::min<size_t>(
+          (size_t)std::ceil(payload_size * opt_.max_clock_drift_ppm * 1e-6) +
+              2,
+          opt_.frame_gap_size);
+      co_await read_till(1 + header_size + payload_size + slack);
+
+      co_return RxFrame{
+          mode, flags, len,
+          Samples{phy_payload.begin() + header_size, phy_payload.end()},
+          payload_size, peak_offset + 1.0};
     }
-
-    co_return phy_payload;
   };
 
   Config::SphyOption opt_;
   std::unique_ptr<Saudio> supersonic_;
-  std::unique_ptr<TxChannel> tx_channel_;
-  OFDM ofdm_;
-  ASK ask_;
-
-  Modulator* modulator_ = &ask_;
+  // preamble threshold, see receive_frame
+  Cfar cfar_;
+
+  // tx pipeline, see tx_worker
+  std::deque<TxRequest> tx_queue_;
+  std::mutex tx_mutex_;
+  std::condition_variable_any tx_cv_;
+  // guarded by tx_mutex_
+  bool tx_modulating_ = false;
+  // steady_clock ticks when the last pushed frame stops playing
+  std::atomic<std::chrono::steady_clock::rep> tx_busy_until_{0};
+
+  // registry of modulators, indexed by Modulation
+  std::vector<std::unique_ptr<Modulator>> modulators_;
+  // and where tx differs, see find_tx_modulator
+  std::vector<std::unique_ptr<Modulator>> tx_modulators_;
+  PhyMode tx_mode_;
+  RxStats last_rx_stats_;
+  size_t rx_detections_ = 0;
+  size_t rx_false_alarms_ = 0;
+  std::optional<uint8_t> rx_filter_;
+  size_t rx_filtered_ = 0;
+  // sub-frames of the last burst, not yet returned by rx
+  std::deque<Bits> rx_pending_;
+
+  // stream being received, see rx_stream_block
+  Stream::State stream_;
+
+  // separate instances, tx and rx may run concurrently
+  RS1511 tx_rs_;
+  RS1511 rx_rs_;
+
+  // rx front end
+  Samples rx_raw_;
+  std::optional<BandFilter> band_filter_;
+  Samples rx_band_;
+  Agc agc_;
+  Samples rx_block_;
+  size_t rx_block_idx_ = 0;
+  Resampler resampler_;
+  double skew_ppm_ = 0.0;
 
   size_t rx_samples_ = 0;
   float max_preamble_corr = 0.0f;
+
+  // last member, stopped and joined before the rest is destroyed
+  std::jthread tx_thread_;
 };
 
 }  // namespace SuperSonic
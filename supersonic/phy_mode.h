@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "crc.h"
+#include "hamming.h"
+#include "utils.h"
+
+namespace SuperSonic {
+
+enum class Modulation : uint8_t {
+  ASK = 0,
+  OFDM = 1,
+  // baseband multi-level, for cables, see pam.h
+  PAM = 2,
+  // M-ary tones, see fsk.h
+  FSK = 3,
+  // differential PSK, see psk.h
+  DBPSK = 4,
+  DQPSK = 5,
+  // chirp spread spectrum, see css.h
+  CSS = 6,
+  // spread by the Gold code of each node, see dsss.h
+  DSSS = 7,
+};
+
+enum class Coding : uint8_t {
+  None = 0,
+  RS1511 = 1,
+};
+
+// Which modulator and which FEC a PHY frame uses.
+struct PhyMode {
+  Modulation modulation = Modulation::ASK;
+  Coding coding = Coding::None;
+
+  bool operator==(const PhyMode&) const = default;
+};
+
+inline std::optional<Modulation> parse_modulation(const std::string& s) {
+  if (s == "ask") {
+    return Modulation::ASK;
+  }
+  if (s == "ofdm") {
+    return Modulation::OFDM;
+  }
+  if (s == "pam") {
+    return Modulation::PAM;
+  }
+  if (s == "fsk") {
+    return Modulation::FSK;
+  }
+  if (s == "dbpsk") {
+    return Modulation::DBPSK;
+  }
+  if (s == "dqpsk") {
+    return Modulation::DQPSK;
+  }
+  if (s == "css") {
+    return Modulation::CSS;
+  }
+  if (s == "dsss") {
+    return Modulation::DSSS;
+  }
+  return std::nullopt;
+}
+
+inline std::optional<Coding> parse_coding(const std::string& s) {
+  if (s == "none") {
+    return Coding::None;
+  }
+  if (s == "rs1511") {
+    return Coding::RS1511;
+  }
+  return std::nullopt;
+}
+
+// ratio of payload bits to coded bits
+inline float code_rate(Coding coding) {
+  switch (coding) {
+    case Coding::RS1511:
+      return 11.0f / 15.0f;
+    default:
+      return 1.0f;
+  }
+}
+
+// rough SNR gain over uncoded transmission
+inline float coding_gain_db(Coding coding) {
+  switch (coding) {
+    case Coding::RS1511:
+      return 2.0f;
+    default:
+      return 0.0f;
+  }
+}
+
+// Frame flags, carried in the PHY header
+namespace FrameFlags {
+// payload is a burst of sub-frames, see burst.h
+static constexpr uint8_t Burst = 1 << 0;
+// payload is a stream of sync word + block pairs, len counts the blocks
+static constexpr uint8_t Stream = 1 << 1;
+// coded payload is scrambled, see scrambler.h
+static constexpr uint8_t Scrambled = 1 << 2;
+}  // namespace FrameFlags
+
+// PHY header: sent right after the preamble, by the modulator of the
+// configured phy mode, and checked before any payload is read.
+// modulation (4 bits) + coding (2 bits) + flags (6 bits) + dest (4 bits)
+// + len (16 bits) + crc8, protected by Hamming(7,4)
+namespace PhyHeader {
+
+static constexpr size_t len_bits = 16;
+// room for more flags, Hamming(7,4) takes the header in nibbles
+static constexpr size_t flags_bits = 6;
+static constexpr size_t dest_bits = 4;
+static constexpr size_t raw_bits = 6 + flags_bits + dest_bits + len_bits;
+static constexpr size_t encoded_bits =
+    Hamming::hamming_encoded_length(raw_bits + 8);
+static constexpr size_t max_len = (1 << len_bits) - 1;
+// dest of frames for every receiver
+static constexpr uint8_t broadcast = (1 << dest_bits) - 1;
+
+struct Value {
+  PhyMode mode;
+  uint8_t flags = 0;
+  uint8_t dest = broadcast;
+  // payload bits, or blocks for FrameFlags::Stream
+  size_t len = 0;
+};
+
+inline Bits encode(const Value& value) {
+  Bits bits(raw_bits);
+  int2Bits(std::to_underlying(value.mode.modulation),
+           MutBitView(bits).subspan(0, 4));
+  int2Bits(std::to_underlying(value.mode.coding),
+           MutBitView(bits).subspan(4, 2));
+  int2Bits(value.flags, MutBitView(bits).subspan(6, flags_bits));
+  int2Bits(value.dest, MutBitView(bits).subspan(6 + flags_bits, dest_bits));
+  int2Bits(value.len,
+           MutBitView(bits).subspan(6 + flags_bits + dest_bits, len_bits));
+  return Hamming::hamming_encode(crc8(bits));
+}
+
+// nullopt if the input is short or the crc does not match
+inline std::optional<Value> decode(BitView encoded) {
+  if (encoded.size() < encoded_bits) {
+    return std::nullopt;
+  }
+  Bits received(encoded.begin(), encoded.begin() + encoded_bits);
+  auto bits = Hamming::hamming_decode(received);
+  if (!validate_crc8(bits)) {
+    return std::nullopt;
+  }
+  return Value{
+      PhyMode{
+          static_cast<Modulation>(bits2Int(BitView(bits).subspan(0, 4))),
+          static_cast<Coding>(bits2Int(BitView(bits).subspan(4, 2))),
+      },
+      static_cast<uint8_t>(bits2Int(BitView(bits).subspan(6, flags_bits))),
+      static_cast<uint8_t>(
+          bits2Int(BitView(bits).subspan(6 + flags_bits, dest_bits))),
+      static_cast<size_t>(bits2Int(
+          BitView(bits).subspan(6 + flags_bits + dest_bits, len_bits))),
+  };
+}
+
+}  // namespace PhyHeader
+
+}  // namespace SuperSonic
@@ -10,7 +10,7 @@ static constexpr int warm_up_rounds = 50;
 
 SuperSonic::RS255223 rs;
 
-awaitable<void> async_send(SuperSonic::Sphy& phy) {
+awaitable<void> async_send(SuperSonic::Sphy& phy, bool stream) {
   using namespace SuperSonic;
 
   // read bits from input.txt
@@ -49,6 +49,13 @@ awaitable<void> async_send(SuperSonic::Sphy& phy) {
 
   LOG_INFO("Total {} data rounds", rounds);
 
+  if (stream) {
+    // one continuous frame, received block by block like the rounds
+    co_await phy.tx_stream(std::move(bits));
+    LOG_INFO("Send finished");
+    co_return;
+  }
+
   for (size_t i = 0; i < rounds; i++) {
     BitView view(bits.data() + i * phy.opt_.bin_payload_size,
                  phy.opt_.bin_payload_size);
@@ -138,13 +145,14 @@ awaitable<void> async_recv(boost::asio::io_context& ctx,
 awaitable<void> async_main(boost::asio::io_context& ctx,
                            SuperSonic::Sphy& phy,
                            SuperSonic::Config::Option& option,
-                           int task) {
+                           int task,
+                           bool stream) {
   co_await phy.init();
 
   auto ex = co_await this_coro::executor;
 
   if (task == 1 || task == 3) {
-    co_spawn(ex, async_send(phy), detached);
+    co_spawn(ex, async_send(phy, stream), detached);
   }
   if (task == 2 || task == 3) {
     co_spawn(ex, async_recv(ctx, phy, option.project1_option.payload_size),
@@ -157,7 +165,8 @@ int main(int argc, char** argv) {
   // clang-format off
   options.add_options()
     ("h,help", "Print usage")
-    ("t,task", "Task to run", cxxopts::value<int>(), "1: Send, 2: Receive, 3: Both");
+    ("t,task", "Task to run", cxxopts::value<int>(), "1: Send, 2: Receive, 3: Both")
+    ("s,stream", "Send data as one continuous stream");
   // clang-format on
   auto result = options.parse(argc, argv);
 
@@ -166,6 +175,7 @@ int main(int argc, char** argv) {
     return 0;
   }
   auto task = result["task"].as<int>();
+  auto stream = result.count("stream") > 0;
 
   auto option = SuperSonic::Config::load_option("config.json");
 
@@ -177,7 +187,7 @@ int main(int argc, char** argv) {
     boost::asio::signal_set signals(io_context, SIGINT, SIGTERM);
     signals.async_wait([&](auto, auto) { io_context.stop(); });
 
-    co_spawn(io_context, async_main(io_context, phy, option, task), detached);
+    co_spawn(io_context, async_main(io_context, phy, option, task, stream), detached);
 
     io_context.run();
   } catch (std::exception& e) {
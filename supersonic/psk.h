@@ -1,50 +1,151 @@
 #pragma once
 
+#include <cmath>
+#include <numbers>
+#include <utility>
+#include <vector>
+
+#include "config.h"
+#include "log.h"
+#include "magic.h"
+#include "modulator.h"
 #include "utils.h"
 
 namespace SuperSonic {
 
-class PSK {
+// Differential PSK on a carrier: DBPSK (1 bit per symbol) or pi/4 DQPSK
+// (2 bits per symbol, Gray coded). The bits are the phase change from one
+// symbol to the next, so a frame starts with a reference symbol. The
+// detector compares each symbol with the one before: an inverted channel or
+// a slowly drifting phase cancels out, no channel estimate is needed.
+// The carrier sits on DFT bin carrier_bin of a symbol, a symbol is read by
+// correlating it with that bin. Phases are multiples of pi/4, the symbols
+// of all 8 are tabled once.
+class DPSK : public Modulator {
  public:
-  // static constexpr size_t symbol_len = 2;
-  // static constexpr std::array<int, symbol_len> one{1, -1};
-  // static constexpr std::array<int, symbol_len> zero{-1, 1};
-
-  static constexpr size_t symbol_len = 4;
-  const std::array<int, symbol_len> one{1, -1, 1, -1};
-  const std::array<int, symbol_len> zero{-1, 1, -1, 1};
-
-  Samples modulate(Bits raw_bits) {
-    Samples wave(raw_bits.size() * symbol_len);
-    for (size_t i = 0; i < raw_bits.size(); i++) {
-      if (raw_bits[i]) {
-        for (size_t j = 0; j < symbol_len; j++) {
-          wave[i * symbol_len + j] = one[j];
-        }
+  const Config::DPSKOption opt;
+
+  DPSK(Config::DPSKOption opt, size_t bits_per_symbol)
+      : opt(opt), bits_(bits_per_symbol) {
+    if (!(bits_ == 1 || bits_ == 2) || opt.carrier_bin < 1 ||
+        2 * (opt.carrier_bin + 1) > opt.symbol_samples) {
+      LOG_ERROR("Invalid DPSK option: symbol_samples {} carrier_bin {}",
+                opt.symbol_samples, opt.carrier_bin);
+      throw std::runtime_error("Invalid DPSK option");
+    }
+    for (int n = 0; n < opt.symbol_samples; n++) {
+      auto w = 2 * std::numbers::pi_v<float> * opt.carrier_bin * n /
+               opt.symbol_samples;
+      cos_.push_back(std::cos(w));
+      sin_.push_back(std::sin(w));
+    }
+    // cos(w n + k pi / 4)
+    rows_.resize(PHASES * opt.symbol_samples);
+    for (int k = 0; k < PHASES; k++) {
+      for (int n = 0; n < opt.symbol_samples; n++) {
+        auto w = 2 * std::numbers::pi * opt.carrier_bin * n /
+                 opt.symbol_samples;
+        rows_[k * opt.symbol_samples + n] =
+            (float)std::cos(w + std::numbers::pi * k / 4);
+      }
+    }
+  }
+
+  size_t phy_payload_size(size_t bin_payload_size) const override {
+    return ((bin_payload_size + bits_ - 1) / bits_ + 1) * opt.symbol_samples;
+  }
+  size_t symbol_samples() const override { return opt.symbol_samples; }
+  size_t bits_per_symbol() const override { return bits_; }
+  // differential detection needs Es/N0 around 9 dB for DBPSK, 13 dB for
+  // DQPSK, a symbol gathers symbol_samples / 2 times the sample snr
+  float min_snr_db() const override {
+    return (bits_ == 1 ? 9.0f : 13.0f) -
+           10.0f * std::log10(opt.symbol_samples / 2.0f);
+  }
+  // main lobe around the carrier
+  Band band() const override {
+    auto spacing = (float)kSampleRate / opt.symbol_samples;
+    return {(opt.carrier_bin - 1) * spacing,
+            (opt.carrier_bin + 1) * spacing};
+  }
+
+  Samples modulate(Bits bits) override {
+    if (bits.size() % bits_ != 0) {
+      LOG_ERROR("Invalid bits size: {}", bits.size());
+      throw std::runtime_error("Invalid bits size");
+    }
+    Samples wave;
+    wave.reserve(phy_payload_size(bits.size()));
+    // reference symbol, then the phase in pi/4
+    int phase = 0;
+    append_symbol(wave, phase);
+    for (size_t i = 0; i < bits.size(); i += bits_) {
+      if (bits_ == 1) {
+        phase += bits[i] ? 4 : 0;
       } else {
-        for (size_t j = 0; j < symbol_len; j++) {
-          wave[i * symbol_len + j] = zero[j];
-        }
+        // see demodulate_soft, the quadrant of the change gives the bits
+        phase += QUADRANT[bits[i] | bits[i + 1] << 1];
       }
+      phase = (phase + PHASES) % PHASES;
+      append_symbol(wave, phase);
     }
     return wave;
   }
 
-  Bits demodulate(SampleView wave) {
-    using SuperSonic::Signal::dot;
-    if (wave.size() % symbol_len != 0) {
+  Bits demodulate(SampleView wave) override {
+    return hard_decision(demodulate_soft(wave));
+  }
+
+  // bit 0 is 1 when the real part of z[k] * conj(z[k - 1]) is negative,
+  // bit 1 of DQPSK when the imaginary part is
+  Llrs demodulate_soft(SampleView wave) override {
+    auto n = opt.symbol_samples;
+    if (wave.size() % n != 0 || wave.size() < (size_t)n) {
       LOG_ERROR("Invalid wave size: {}", wave.size());
       return {};
     }
-    Bits bits(wave.size() / symbol_len);
-    for (size_t i = 0; i < wave.size(); i += symbol_len) {
-      auto symbol = wave.subspan(i, symbol_len);
-      auto one_dot = dot(symbol, one);
-      auto zero_dot = dot(symbol, zero);
-      bits[i / symbol_len] = one_dot > zero_dot;
+    auto symbols = wave.size() / n;
+    Samples metrics;
+    metrics.reserve((symbols - 1) * bits_);
+    auto [re0, im0] = correlate(wave.subspan(0, n));
+    for (size_t k = 1; k < symbols; k++) {
+      auto [re, im] = correlate(wave.subspan(k * n, n));
+      metrics.push_back(-(re * re0 + im * im0));
+      if (bits_ == 2) {
+        metrics.push_back(-(im * re0 - re * im0));
+      }
+      re0 = re;
+      im0 = im;
     }
-    return bits;
+    return Signal::metrics_to_llrs(std::move(metrics));
   }
+
+ private:
+  // phase change of DQPSK in pi/4, by bit 0 | bit 1 << 1
+  static constexpr int QUADRANT[4] = {1, 3, -1, -3};
+  static constexpr int PHASES = 8;
+
+  // cos(w n + phase * pi / 4)
+  void append_symbol(Samples& wave, int phase) const {
+    auto row = rows_.begin() + phase * opt.symbol_samples;
+    wave.insert(wave.end(), row, row + opt.symbol_samples);
+  }
+
+  // the carrier bin of a symbol, e^(j phase) up to a factor
+  std::pair<float, float> correlate(SampleView symbol) const {
+    float re = 0.0f, im = 0.0f;
+    for (int j = 0; j < opt.symbol_samples; j++) {
+      re += symbol[j] * cos_[j];
+      im -= symbol[j] * sin_[j];
+    }
+    return {re, im};
+  }
+
+  size_t bits_;
+  Samples cos_;
+  Samples sin_;
+  // symbol of phase k at k * symbol_samples
+  Samples rows_;
 };
 
-}  // namespace SuperSonic
\ No newline at end of file
+}  // namespace SuperSonic
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#include "utils.h"
+
+namespace SuperSonic {
+
+// Streaming fractional resampler, cubic lagrange interpolation in Farrow form.
+// Each output sample advances the input by step, which can be changed at any
+// time. Outputs are produced in runs where the input index advances by
+// exactly one per output, so the taps are contiguous loads and mu is linear
+// in the output index; each run is computed 4 outputs at a time with SSE2.
+// For a clock skew of s ppm a run is about 1e6 / s samples long.
+class Resampler {
+ public:
+  explicit Resampler(double step = 1.0) : step_(step) {
+    // start with 1 sample of history for the cubic
+    buffer_.push_back(0.0f);
+    pos_ = 1.0;
+  }
+
+  double step() const { return step_; }
+  void set_step(double step) { step_ = step; }
+
+  // resample in, append to out
+  void process(SampleView in, Samples& out) {
+    buffer_.insert(buffer_.end(), in.begin(), in.end());
+
+    // outputs need buffer_[i - 1 .. i + 2]
+    auto last = (double)buffer_.size() - 3;
+    auto dmu = step_ - 1.0;
+    while (pos_ <= last) {
+      auto i = (size_t)pos_;
+      auto mu0 = pos_ - i;
+
+      // run while floor(pos_ + k * step_) == i + k
+      auto n = (size_t)(last - i) + 1;
+      if (dmu > 0) {
+        n = std::min(n, (size_t)std::ceil((1.0 - mu0) / dmu));
+      } else if (dmu < 0) {
+        n = std::min(n, (size_t)std::floor(mu0 / -dmu) + 1);
+      }
+
+      auto base = out.size();
+      out.resize(base + n);
+      farrow(buffer_.data() + i - 1, (float)mu0, (float)dmu, (int)n,
+             out.data() + base);
+      pos_ += n * step_;
+    }
+    compact();
+  }
+
+ private:
+  // y[k] from x[k .. k + 3] at mu0 + k * dmu past x[k + 1],
+  // 4 outputs at a time with SSE2
+  static void farrow(const float* x, float mu0, float dmu, int n, float* y) {
+    int k = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+    const auto third = _mm_set1_ps(1.0f / 3);
+    const auto half = _mm_set1_ps(0.5f);
+    const auto sixth = _mm_set1_ps(1.0f / 6);
+    const auto ramp = _mm_mul_ps(_mm_set_ps(3, 2, 1, 0), _mm_set1_ps(dmu));
+    for (; k + 4 <= n; k += 4) {
+      auto xm1 = _mm_loadu_ps(x + k);
+      auto x0 = _mm_loadu_ps(x + k + 1);
+      auto x1 = _mm_loadu_ps(x + k + 2);
+      auto x2 = _mm_loadu_ps(x + k + 3);
+      auto c1 = _mm_sub_ps(
+          _mm_sub_ps(_mm_sub_ps(x1, _mm_mul_ps(xm1, third)),
+                     _mm_mul_ps(x0, half)),
+          _mm_mul_ps(x2, sixth));
+      auto c2 = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(xm1, x1), half), x0);
+      auto c3 = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(x2, xm1), sixth),
+                           _mm_mul_ps(_mm_sub_ps(x0, x1), half));
+      auto mu = _mm_add_ps(_mm_set1_ps(mu0 + k * dmu), ramp);
+      auto r = _mm_add_ps(_mm_mul_ps(c3, mu), c2);
+      r = _mm_add_ps(_mm_mul_ps(r, mu), c1);
+      r = _mm_add_ps(_mm_mul_ps(r, mu), x0);
+      _mm_storeu_ps(y + k, r);
+    }
+#endif
+    for (; k < n; k++) {
+      y[k] = farrow_at(x + k, mu0 + k * dmu);
+    }
+  }
+
+  // 4-point lagrange interpolation between x[1] and x[2], in Farrow form
+  static float farrow_at(const float* x, float mu) {
+    auto xm1 = x[0], x0 = x[1], x1 = x[2], x2 = x[3];
+    auto c0 = x0;
+    auto c1 = -xm1 / 3 - x0 / 2 + x1 - x2 / 6;
+    auto c2 = (xm1 + x1) / 2 - x0;
+    auto c3 = (x2 - xm1) / 6 + (x0 - x1) / 2;
+    return ((c3 * mu + c2) * mu + c1) * mu + c0;
+  }
+
+  // drop consumed input, keep 1 sample of history
+  void compact() {
+    auto consumed = (size_t)std::floor(pos_) - 1;
+    if (consumed == 0) {
+      return;
+    }
+    consumed = std::min(consumed, buffer_.size());
+    buffer_.erase(buffer_.begin(), buffer_.begin() + consumed);
+    pos_ -= consumed;
+  }
+
+  double step_;
+  double pos_;
+  Samples buffer_;
+};
+
+}  // namespace SuperSonic
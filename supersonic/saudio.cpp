@@ -331,33 +331,11 @@ Saudio::~Saudio() {
 void Saudio::process_callback(const void* pInput,
                               void* pOutput,
                               uint32_t frameCount) {
-  auto rx = (const float*)pInput;
   auto tx = (float*)pOutput;
-
-  float rx_energy = 0.0f;
-  for (uint32_t i = 0; i < frameCount; i++) {
-    rx_energy += rx[i] * rx[i];
-  }
-  float rx_power = rx_energy / frameCount;
-  rx_power_.store(rx_power, std::memory_order_relaxed);
-
-  if (rx_buffer.write_available() < frameCount) {
-    LOG_WARN("Rx buffer is full. Going to reset RX buffer.");
-    rx_buffer.consume_all([](float) {});
-  }
-  auto pushed = rx_buffer.push(rx, frameCount);
-  if (pushed != frameCount) {
-    LOG_ERROR(
-        "rx_buffer.push failed. Expected to push {}, but pushed {}."
-        "This should not happen.",
-        frameCount, pushed);
-  }
-
-  if (opt_.enable_raw_log) {
-    if (log_rx_buffer.push(rx, frameCount) != frameCount) {
-      LOG_ERROR("log_rx_buffer.push failed.");
-    }
-  }
+  // the output is written first, the echo canceller takes it as the
+  // reference of the capture. The two buffers may alias, keep the capture
+  rx_capture_.assign((const float*)pInput, (const float*)pInput + frameCount);
+  auto rx = rx_capture_.data();
 
   size_t wrote = 0;
   while (wrote < frameCount && tx_buffer.read_available()) {
@@ -379,10 +357,37 @@ void Saudio::process_callback(const void* pInput,
   std::fill(tx + wrote, tx + frameCount, .0f);
 
   if (opt_.enable_raw_log) {
+    if (log_rx_buffer.push(rx, frameCount) != frameCount) {
+      LOG_ERROR("log_rx_buffer.push failed.");
+    }
     if (log_tx_buffer.push(tx, frameCount) != frameCount) {
       LOG_ERROR("log_tx_buffer.push failed.");
     }
   }
+
+  // from here on the capture is what others send, rx_power included
+  if (echo_) {
+    echo_->process(rx, tx, rx, frameCount);
+  }
+
+  float rx_energy = 0.0f;
+  for (uint32_t i = 0; i < frameCount; i++) {
+    rx_energy += rx[i] * rx[i];
+  }
+  float rx_power = rx_energy / frameCount;
+  rx_power_.store(rx_power, std::memory_order_relaxed);
+
+  if (rx_buffer.write_available() < frameCount) {
+    LOG_WARN("Rx buffer is full. Going to reset RX buffer.");
+    rx_buffer.consume_all([](float) {});
+  }
+  auto pushed = rx_buffer.push(rx, frameCount);
+  if (pushed != frameCount) {
+    LOG_ERROR(
+        "rx_buffer.push failed. Expected to push {}, but pushed {}."
+        "This should not happen.",
+        frameCount, pushed);
+  }
 }
 
 }  // namespace SuperSonic
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#include "utils.h"
+
+namespace SuperSonic {
+
+// Additive scrambler of the coded payload, the PRBS of x^15 + x^14 + 1
+// restarted from SEED at every frame (every block of a stream), so runs of
+// zeros from padding or headers do not turn into a repetitive waveform.
+// Scrambling twice gives the input back, the receiver flips the sign of the
+// llrs instead of the bits so soft decoding is unaffected.
+// The sequence is made 14 bits per step and used 64 bits at a time.
+class Scrambler {
+ public:
+  // DVB initial state
+  static constexpr uint32_t SEED = 0b100101010000000;
+
+  Scrambler() = default;
+
+  void apply(MutBitView bits) {
+    size_t i = 0;
+    for (; i + 64 <= bits.size(); i += 64) {
+      auto word = next_word();
+      if constexpr (std::endian::native == std::endian::little) {
+        // 8 bits per uint64_t, one in the low bit of each byte
+        for (size_t j = 0; j < 64; j += 8) {
+          uint64_t lanes;
+          std::memcpy(&lanes, bits.data() + i + j, 8);
+          lanes ^= spread(word >> j);
+          std::memcpy(bits.data() + i + j, &lanes, 8);
+        }
+      } else {
+        for (size_t j = 0; j < 64; j++) {
+          bits[i + j] ^= (word >> j) & 1;
+        }
+      }
+    }
+    if (i < bits.size()) {
+      auto word = next_word();
+      for (size_t j = 0; i + j < bits.size(); j++) {
+        bits[i + j] ^= (word >> j) & 1;
+      }
+    }
+  }
+
+  void apply(MutSampleView llrs) {
+    for (size_t i = 0; i < llrs.size(); i += 64) {
+      auto word = next_word();
+      for (size_t j = 0; j < 64 && i + j < llrs.size(); j++) {
+        auto sign = (uint32_t)((word >> j) & 1) << 31;
+        llrs[i + j] =
+            std::bit_cast<float>(std::bit_cast<uint32_t>(llrs[i + j]) ^ sign);
+      }
+    }
+  }
+
+ private:
+  static constexpr int CHUNK = 14;
+
+  // next 14 bits of the sequence, s[n] = s[n - 14] ^ s[n - 15]
+  uint64_t step() {
+    // bit i of state_ is s[n - 15 + i]
+    uint32_t bits = (state_ ^ (state_ >> 1)) & ((1u << CHUNK) - 1);
+    state_ = (state_ >> CHUNK) | (bits << 1);
+    return bits;
+  }
+
+  uint64_t next_word() {
+    uint64_t word = carry_;
+    int n = carry_bits_;
+    carry_ = 0;
+    carry_bits_ = 0;
+    while (n < 64) {
+      auto bits = step();
+      word |= bits << n;
+      if (n + CHUNK > 64) {
+        carry_ = bits >> (64 - n);
+        carry_bits_ = n + CHUNK - 64;
+      }
+      n += CHUNK;
+    }
+    return word;
+  }
+
+  // bit i of the low byte of x to the low bit of byte i
+  static uint64_t spread(uint64_t x) {
+    x &= 0xFF;
+    x = (x | x << 28) & 0x0000000F0000000FULL;
+    x = (x | x << 14) & 0x0003000300030003ULL;
+    x = (x | x << 7) & 0x0101010101010101ULL;
+    return x;
+  }
+
+  uint32_t state_ = SEED;
+  uint64_t carry_ = 0;
+  int carry_bits_ = 0;
+};
+
+}  // namespace SuperSonic
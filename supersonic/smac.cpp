@@ -33,6 +33,7 @@ awaitable<void> Smac::run() {
   rx_data_channel_ = std::make_unique<RxDataChannel>(ex, RX_BUFFER_SIZE);
 
   static constexpr int TX_BUFFER_SIZE = 0;
+  static constexpr size_t MAX_TX_BATCH = Sphy::TX_PIPELINE_DEPTH - 2;
   tx_channel_ = std::make_unique<TxChannel>(ex, TX_BUFFER_SIZE);
   tx_comp_channel_ = std::make_unique<TxCompChannel>(ex, TX_BUFFER_SIZE);
 
@@ -52,9 +53,11 @@ awaitable<void> Smac::run() {
 
     // valid if state == Sending
     Bits bits;
+    // more payloads sent right after bits, without ack
+    std::vector<Bits> batch;
 
-    // valid if state == WaitingAck
-    Frame frame;
+    // valid if state == WaitingAck, every frame sent, in seq order
+    std::vector<Frame> frames;
 
     // valid if state == Sending or WaitingAck
     std::chrono::time_point<std::chrono::high_resolution_clock> timeout_ts;
@@ -85,7 +88,18 @@ awaitable<void> Smac::run() {
       throw std::runtime_error("Invalid state");
     }
 
-    if (phy_.supersonic_->rx_power() > opt_.busy_power_threshold) {
+    // while our own frames play the channel is ours, and rx_power is
+    // our own signal, unless the echo canceller takes it out: then another
+    // node sending over our frames is a collision, and the next ones wait.
+    // In full duplex the peer sends in the other band, our band is always
+    // free
+    auto own_signal = phy_.tx_active() && !phy_.supersonic_->echo_cancel();
+    if (!phy_.opt_.duplex_option.enabled && !own_signal &&
+        phy_.supersonic_->rx_power() > opt_.busy_power_threshold) {
+      if (phy_.tx_active()) {
+        LOG_WARN("Collision, {} > {} while sending",
+                 phy_.supersonic_->rx_power(), opt_.busy_power_threshold);
+      }
       if (tx_state.retries >= opt_.max_retries) {
         LOG_ERROR("Channel busy. Max retries reached, LINK ERROR");
         throw std::runtime_error("LINK ERROR");
@@ -109,19 +123,39 @@ awaitable<void> Smac::run() {
       tx_seq_map[dest] = 0;
     }
 
-    Frame frame{opt_.mac_addr, dest, FrameType::Data, tx_seq_map[dest],
-                tx_state.bits};
-    co_await tx_frame(frame);
-    LOG_INFO("Sent frame dest {} seq {} payload size {}, wait ack", frame.dest,
-             frame.seq, frame.payload.size());
+    // one seq per frame, the ack of the last one acknowledges them all
+    std::vector<Frame> frames;
+    auto seq = tx_seq_map[dest];
+    frames.push_back(
+        Frame{opt_.mac_addr, dest, FrameType::Data, seq, tx_state.bits});
+    for (auto& bits : tx_state.batch) {
+      seq = next_seq(seq);
+      frames.push_back(Frame{opt_.mac_addr, dest, FrameType::Data, seq, bits});
+    }
+
+    auto mode = opt_.adapt ? adapter(dest).mode() : phy_.tx_mode();
+    std::vector<Bits> frame_bits;
+    for (auto& frame : frames) {
+      frame_bits.push_back(make_frame(frame));
+    }
+    // queued together, Sphy sends them as one burst when they fit in
+    // max_burst_ms
+    co_await phy_.tx(std::move(frame_bits), mode, dest);
+    // no wait for playback: with ACKs disabled nothing needs the end time,
+    // and the next frame is modulated while this one plays
+    LOG_INFO("Queued {} frames dest {} seq {} to {}, wait ack", frames.size(),
+             dest, frames.front().seq, frames.back().seq);
 
     tx_state.state = TxState::State::WaitingAck;
-    tx_state.frame = frame;
+    tx_state.frames = std::move(frames);
     tx_state.timeout_ts = std::chrono::high_resolution_clock::now() +
                           std::chrono::milliseconds(opt_.timeout_ms);
 
     tx_state.state = TxState::State::Idle;
-    co_await tx_comp_channel_->async_send({}, 0);
+    for (size_t i = 0; i <= tx_state.batch.size(); i++) {
+      co_await tx_comp_channel_->async_send({}, 0);
+    }
+    tx_state.batch.clear();
   };
 
   auto tx_data_resend = [&]() -> awaitable<void> {
@@ -157,8 +191,16 @@ awaitable<void> Smac::run() {
       co_return;
     }
 
-    auto expect_seq = next_seq(tx_state.frame.seq);
+    auto expect_seq = next_seq(tx_state.frames.back().seq);
     if (ack_frame.seq != expect_seq) {
+      // acks of the earlier frames of a batch, keep waiting for the last
+      for (size_t i = 0; i + 1 < tx_state.frames.size(); i++) {
+        if (ack_frame.seq == next_seq(tx_state.frames[i].seq)) {
+          LOG_INFO("Received ACK seq {}, {} frames to go", ack_frame.seq,
+                   tx_state.frames.size() - 1 - i);
+          co_return;
+        }
+      }
       LOG_WARN(
           "Received ACK frame src {} dst {} seq {}, seq is not expected "
           "{}, retry {}",
@@ -171,13 +213,22 @@ awaitable<void> Smac::run() {
     // Correctly received ACK
     LOG_INFO("Correctly received ACK src {} dst {} seq {}", ack_frame.src,
              ack_frame.dest, ack_frame.seq);
-    co_await tx_comp_channel_->async_send({}, 0);
+    for (size_t i = 0; i < tx_state.frames.size(); i++) {
+      co_await tx_comp_channel_->async_send({}, 0);
+    }
 
-    tx_seq_map[tx_state.frame.dest] = next_seq(tx_seq_map[tx_state.frame.dest]);
+    tx_seq_map[tx_state.frames.back().dest] = expect_seq;
 
     tx_state.state = TxState::State::Idle;
+    tx_state.batch.clear();
   };
 
+  struct RxLinkStats {
+    int frames = 0;
+    float snr_db = 0.0f;
+  };
+  std::map<uint8_t, RxLinkStats> rx_link_stats;
+
   auto rx_data = [&](Frame& frame) -> awaitable<void> {
     LOG_INFO("rx_data");
     if (frame.type != FrameType::Data) {
@@ -212,6 +263,24 @@ awaitable<void> Smac::run() {
     co_await rx_data_channel_->async_send({}, frame.payload);
     LOG_INFO("Frame pushed to rx data channel");
 
+    // report link quality back to the sender
+    if (opt_.adapt) {
+      auto& stats = rx_link_stats[frame.src];
+      stats.snr_db = stats.frames == 0
+                         ? frame.snr_db
+                         : 0.75f * stats.snr_db + 0.25f * frame.snr_db;
+      stats.frames++;
+      if (stats.frames >= opt_.report_interval) {
+        Frame report_frame{opt_.mac_addr, frame.src, FrameType::Report, 0,
+                           make_report({stats.snr_db, rx_crc_errors_})};
+        LOG_INFO("Sending report to {}: snr {} dB, {} crc errors", frame.src,
+                 stats.snr_db, rx_crc_errors_);
+        stats.frames = 0;
+        rx_crc_errors_ = 0;
+        co_await tx_frame(report_frame, phy_.opt_.phy_mode);
+      }
+    }
+
     // Send ACK with next seq
     // Frame ack_frame{
     //     opt_.mac_addr, frame.src, FrameType::Ack, rx_seq_map[frame.src], {}};
@@ -219,6 +288,23 @@ awaitable<void> Smac::run() {
     // LOG_INFO("ACK sent");
   };
 
+  auto rx_report = [&](Frame& frame) {
+    auto report = parse_report(frame.payload);
+    LOG_INFO("Received report from {}: snr {} dB, {} crc errors", frame.src,
+             report.snr_db, report.errors);
+    if (opt_.adapt) {
+      adapter(frame.src).on_report(report.snr_db, report.errors);
+    }
+  };
+
+  auto rx_frame = [&](Frame& frame) -> awaitable<void> {
+    if (frame.type == FrameType::Report) {
+      rx_report(frame);
+      co_return;
+    }
+    co_await rx_data(frame);
+  };
+
   while (1) {
     LOG_INFO("State {}", std::to_underlying(tx_state.state));
     if (tx_state.state == TxState::State::Idle) {
@@ -234,6 +320,14 @@ awaitable<void> Smac::run() {
 
         tx_state.state = TxState::State::Sending;
         tx_state.bits = bits;
+        // take the other senders waiting, to share a burst
+        tx_state.batch.clear();
+        while (phy_.opt_.max_burst_ms > 0 &&
+               tx_state.batch.size() < MAX_TX_BATCH &&
+               tx_channel_->try_receive([&](auto, Bits more) {
+                 tx_state.batch.push_back(std::move(more));
+               })) {
+        }
         tx_state.retries = 0;
         tx_state.resend = 0;
         co_await tx_data();
@@ -241,7 +335,7 @@ awaitable<void> Smac::run() {
         LOG_INFO("RX");
         // RX
         auto frame = std::get<1>(result);
-        co_await rx_data(frame);
+        co_await rx_frame(frame);
       }
       continue;
     }
@@ -264,7 +358,7 @@ awaitable<void> Smac::run() {
       if (result.index() == 0) {
         // recv data
         auto& frame = std::get<0>(result);
-        co_await rx_data(frame);
+        co_await rx_frame(frame);
       } else if (result.index() == 1) {
         // retry
         co_await tx_data();
@@ -293,7 +387,7 @@ awaitable<void> Smac::run() {
         if (frame.type == FrameType::Ack) {
           co_await rx_ack(frame);
         } else {
-          co_await rx_data(frame);
+          co_await rx_frame(frame);
         }
       } else if (result.index() == 1) {
         // resend
@@ -314,9 +408,11 @@ awaitable<void> Smac::listen() {
     auto crc_result = validate_crc16(rx_bits);
     if (!crc_result) {
       LOG_WARN("CRC check failed, drop the frame");
+      rx_crc_errors_++;
       continue;
     }
     auto rx_frame = parse_frame(rx_bits);
+    rx_frame.snr_db = phy_.last_rx_stats().snr_db;
     if (rx_frame.dest != opt_.mac_addr) {
       // LOG_INFO("Frame dest {} is not me {}", rx_frame.dest, opt_.mac_addr);
       continue;
@@ -355,6 +451,52 @@ void Smac::set_frame_seq(MutBitView frame, uint8_t seq) {
   int2Bits(seq, frame.subspan(src_bits + dest_bits + type_bits, seq_bits));
 }
 
+Bits Smac::make_report(const Report& report) {
+  auto snr_q = std::clamp((int)std::lround(report.snr_db * 2), 0, 255);
+  auto errors = std::clamp(report.errors, 0, 255);
+  return Signal::concatenate(int2Bits(snr_q, 8), int2Bits(errors, 8));
+}
+Smac::Report Smac::parse_report(BitView payload) {
+  if (payload.size() < report_bits) {
+    LOG_WARN("Report too short");
+    return {0.0f, 0};
+  }
+  return {bits2Int(payload.subspan(0, 8)) / 2.0f,
+          bits2Int(payload.subspan(8, 8))};
+}
+
+LinkAdapter& Smac::adapter(uint8_t dest) {
+  auto it = adapters_.find(dest);
+  if (it != adapters_.end()) {
+    return it->second;
+  }
+
+  auto modulations = opt_.adapt_modulations.empty() ? phy_.modulations()
+                                                    : opt_.adapt_modulations;
+  std::vector<LinkAdapter::Candidate> candidates;
+  for (auto modulation : modulations) {
+    auto* modulator = phy_.find_modulator(modulation);
+    if (modulator == nullptr) {
+      LOG_ERROR("Modulation {} not registered",
+                std::to_underlying(modulation));
+      throw std::runtime_error("Modulation not registered");
+    }
+    for (auto coding : {Coding::RS1511, Coding::None}) {
+      candidates.push_back({{modulation, coding}, modulator});
+    }
+  }
+  auto ladder = LinkAdapter::make_ladder(candidates);
+  for (auto& rung : ladder) {
+    LOG_INFO("Ladder: modulation {} coding {} rate {} min snr {} dB",
+             std::to_underlying(rung.mode.modulation),
+             std::to_underlying(rung.mode.coding), rung.rate, rung.min_snr_db);
+  }
+  return adapters_
+      .emplace(dest, LinkAdapter(std::move(ladder), opt_.adapt_hysteresis_db,
+                                 opt_.adapt_up_reports))
+      .first->second;
+}
+
 Smac::Frame Smac::parse_frame(BitView frame) {
   if (frame.size() < header_bits + crc_bits) {
     LOG_ERROR("Frame too short");
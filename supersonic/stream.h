@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "log.h"
+#include "modulator.h"
+#include "phy_mode.h"
+#include "timing.h"
+#include "utils.h"
+
+namespace SuperSonic {
+
+// Stream payload: after the PHY header, len blocks each made of a sync word
+// and a coded block. The receiver searches the sync word around the tracked
+// position to stay locked, and carries the timing from block to block.
+namespace Stream {
+
+// barker 13
+static inline const Bits sync_word{1, 1, 1, 1, 1, 0, 0, 1, 1, 0, 1, 0, 1};
+// sync word search range, in samples around the tracked position
+static constexpr int SYNC_SEARCH = 4;
+static constexpr float SYNC_THRESHOLD = 0.5f;
+// lock is lost after this many missed sync words in a row
+static constexpr int MAX_MISSES = 3;
+
+// stream being received
+struct State {
+  PhyMode mode;
+  size_t blocks_left = 0;
+  // received samples not consumed yet
+  Samples wave;
+  // start of the next block in wave, and the tracked drift
+  double pos = 0.0;
+  double drift = 0.0;
+  int misses = 0;
+  size_t samples = 0;
+  // FrameFlags of the header
+  uint8_t flags = 0;
+};
+
+struct Block {
+  // empty if the lock is lost
+  Llrs llrs;
+  // the aligned payload
+  Samples wave;
+  float sync_corr = 0.0f;
+};
+
+// samples state.wave must hold before demodulate_block
+inline size_t samples_needed(const State& state,
+                             size_t block_size,
+                             double max_drift_ppm,
+                             size_t max_slack) {
+  auto slack = std::min<size_t>(
+      SYNC_SEARCH + (size_t)std::ceil(block_size * max_drift_ppm * 1e-6) + 2,
+      max_slack);
+  return (size_t)std::max(0.0, std::ceil(state.pos)) + block_size + slack;
+}
+
+// realign on the sync word, then demodulate the payload after it with the
+// timing tracker. Advances state past the block and drops the samples no
+// longer needed from state.wave. The drift carried to the next block is
+// bounded by max_drift_ppm, a short block gives a noisy estimate.
+inline Block demodulate_block(Modulator& modulator,
+                              SampleView sync_wave,
+                              size_t payload_size,
+                              double max_drift_ppm,
+                              State& state) {
+  using Signal::dot;
+
+  auto step = 1.0 + state.drift;
+  auto sync_energy = dot(sync_wave, sync_wave);
+  double best_pos = state.pos;
+  float best_corr = -1.0f;
+  for (int d = -SYNC_SEARCH; d <= SYNC_SEARCH; d++) {
+    auto x = Signal::fractional_resample(state.wave, state.pos + d, step,
+                                         sync_wave.size());
+    auto energy = dot(SampleView{x}, SampleView{x}) * sync_energy;
+    auto corr =
+        dot(SampleView{x}, sync_wave) / std::sqrt(std::max(energy, 1e-12f));
+    if (corr > best_corr) {
+      best_corr = corr;
+      best_pos = state.pos + d;
+    }
+  }
+  if (best_corr >= SYNC_THRESHOLD) {
+    state.pos = best_pos;
+    state.misses = 0;
+  } else if (++state.misses >= MAX_MISSES) {
+    return Block{{}, {}, best_corr};
+  } else {
+    LOG_WARN("Stream sync word missed, corr {}", best_corr);
+  }
+
+  auto tracked = TimingTracker::demodulate(modulator, state.wave, payload_size,
+                                           state.pos + sync_wave.size() * step,
+                                           state.drift);
+  state.pos = tracked.offset + payload_size;
+  state.drift =
+      std::clamp(tracked.drift, -max_drift_ppm * 1e-6, max_drift_ppm * 1e-6);
+  state.samples += sync_wave.size() + payload_size;
+
+  // keep a little history for the next sync search
+  auto consumed =
+      (size_t)std::max(0.0, std::floor(state.pos) - (SYNC_SEARCH + 2));
+  consumed = std::min(consumed, state.wave.size());
+  state.wave.erase(state.wave.begin(), state.wave.begin() + consumed);
+  state.pos -= consumed;
+
+  return Block{std::move(tracked.llrs), std::move(tracked.wave), best_corr};
+}
+
+}  // namespace Stream
+
+}  // namespace SuperSonic
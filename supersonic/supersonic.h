@@ -5,6 +5,7 @@
 #include <boost/lockfree/spsc_queue.hpp>
 
 #include "config.h"
+#include "echo.h"
 #include "utils.h"
 
 namespace SuperSonic {
@@ -34,7 +35,11 @@ class Saudio {
   Saudio(Config::SaudioOption& opt)
       : opt_(opt),
         rx_buffer(opt.ringbuffer_size),
-        tx_buffer(opt.ringbuffer_size) {}
+        tx_buffer(opt.ringbuffer_size) {
+    if (opt.echo_option.enabled) {
+      echo_.emplace(opt.echo_option);
+    }
+  }
 
   int run_jack();
   int run_ma();
@@ -62,11 +67,17 @@ class Saudio {
 
   std::atomic<float> rx_power_;
 
+  // audio thread only, see process_callback
+  std::optional<EchoCanceller> echo_;
+  Samples rx_capture_;
+
  public:
   RxRingBuffer rx_buffer;
   TxRingBuffer tx_buffer;
 
+  // of the last callback, without our own echo when echo_option is enabled
   float rx_power() { return rx_power_.load(std::memory_order_relaxed); }
+  bool echo_cancel() const { return echo_.has_value(); }
 
  public:
   // this is called in audio thread
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "modulator.h"
+#include "utils.h"
+
+namespace SuperSonic {
+
+namespace Signal {
+
+// 4-point cubic lagrange interpolation of x at fractional position pos,
+// samples outside x are taken as 0
+inline float interpolate(SampleView x, double pos) {
+  auto i = (long)std::floor(pos);
+  auto mu = (float)(pos - i);
+  auto at = [&](long k) {
+    return (0 <= k && k < (long)x.size()) ? x[k] : 0.0f;
+  };
+  float cm1 = -mu * (mu - 1) * (mu - 2) / 6;
+  float c0 = (mu + 1) * (mu - 1) * (mu - 2) / 2;
+  float c1 = -(mu + 1) * mu * (mu - 2) / 2;
+  float c2 = (mu + 1) * mu * (mu - 1) / 6;
+  return cm1 * at(i - 1) + c0 * at(i) + c1 * at(i + 1) + c2 * at(i + 2);
+}
+
+// n samples of x, starting at fractional position start, step apart
+inline Samples fractional_resample(SampleView x,
+                                   double start,
+                                   double step,
+                                   size_t n) {
+  Samples result(n);
+  for (size_t i = 0; i < n; i++) {
+    result[i] = interpolate(x, start + i * step);
+  }
+  return result;
+}
+
+// offset in [-0.5, 0.5] of the vertex of the parabola through
+// (-1, l), (0, c), (1, r), 0 if c is not a peak
+inline double parabolic_peak(float l, float c, float r) {
+  auto curvature = l - 2 * c + r;
+  if (curvature >= 0) {
+    return 0.0;
+  }
+  return std::clamp(0.5 * (l - r) / curvature, -0.5, 0.5);
+}
+
+}  // namespace Signal
+
+// Symbol timing tracking for long frames.
+// The payload is demodulated in blocks of a few symbols. For each block an
+// early-late gate compares the mean |llr| half a sample early and late, and a
+// second order loop corrects both the timing offset and the sample clock
+// drift for the next block.
+class TimingTracker {
+ public:
+  static constexpr size_t BLOCK_MIN_SAMPLES = 128;
+  static constexpr float EARLY_LATE = 0.5f;
+  static constexpr float OFFSET_GAIN = 0.5f;
+  static constexpr float DRIFT_GAIN = 0.1f;
+
+  struct Result {
+    Llrs llrs;
+    // the payload resampled on the tracked symbol grid
+    Samples wave;
+    // timing offset (samples) and drift (samples per sample) at the end
+    double offset;
+    double drift;
+  };
+
+  // symbol based modulators can be demodulated block by block
+  static bool can_track(const Modulator& modulator) {
+    return modulator.phy_payload_size(modulator.bits_per_symbol()) ==
+           modulator.symbol_samples();
+  }
+
+  // demodulate payload_size samples of wave, starting at offset
+  static Result demodulate(Modulator& modulator,
+                           SampleView wave,
+                           size_t payload_size,
+                           double offset = 0.0,
+                           double drift = 0.0) {
+    if (!can_track(modulator)) {
+      auto aligned =
+          Signal::fractional_resample(wave, offset, 1.0 + drift, payload_size);
+      auto llrs = modulator.demodulate_soft(aligned);
+      return {std::move(llrs), std::move(aligned), offset, drift};
+    }
+
+    auto symbol_samples = modulator.symbol_samples();
+    auto symbols = payload_size / symbol_samples;
+    auto block_symbols =
+        std::max<size_t>(1, (BLOCK_MIN_SAMPLES + symbol_samples - 1) /
+                                symbol_samples);
+
+    auto mean_abs = [](const Llrs& llrs) {
+      float sum = 0.0f;
+      for (auto e : llrs) {
+        sum += std::abs(e);
+      }
+      return llrs.empty() ? 0.0f : sum / llrs.size();
+    };
+
+    Result result;
+    result.llrs.reserve(symbols * modulator.bits_per_symbol());
+    result.wave.reserve(symbols * symbol_samples);
+
+    double pos = offset;
+    for (size_t i = 0; i < symbols; i += block_symbols) {
+      auto n = std::min(block_symbols, symbols - i) * symbol_samples;
+      auto step = 1.0 + drift;
+
+      auto block = Signal::fractional_resample(wave, pos, step, n);
+      auto llrs = modulator.demodulate_soft(block);
+      auto early = mean_abs(modulator.demodulate_soft(
+          Signal::fractional_resample(wave, pos - EARLY_LATE, step, n)));
+      auto late = mean_abs(modulator.demodulate_soft(
+          Signal::fractional_resample(wave, pos + EARLY_LATE, step, n)));
+      auto on_time = mean_abs(llrs);
+
+      // peak of the parabola through early, on time and late
+      float error = 0.0f;
+      auto curvature = early - 2 * on_time + late;
+      if (curvature < 0) {
+        error = EARLY_LATE * (early - late) / (2 * curvature);
+      } else if (early != late) {
+        error = late > early ? EARLY_LATE : -EARLY_LATE;
+      }
+      error = std::clamp(error, -EARLY_LATE, EARLY_LATE);
+
+      result.llrs.insert(result.llrs.end(), llrs.begin(), llrs.end());
+      result.wave.insert(result.wave.end(), block.begin(), block.end());
+
+      pos += n * step + OFFSET_GAIN * error;
+      drift += DRIFT_GAIN * error / n;
+    }
+
+    result.offset = pos - (double)symbols * symbol_samples;
+    result.drift = drift;
+    return result;
+  }
+};
+
+}  // namespace SuperSonic
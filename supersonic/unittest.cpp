@@ -1,8 +1,29 @@
 #define BOOST_TEST_MODULE SuperSonicTest
 #include <boost/test/included/unit_test.hpp>  //single-header
 
+#include <random>
+
+#include "adapt.h"
+#include "agc.h"
+#include "ask.h"
+#include "burst.h"
+#include "cfar.h"
+#include "chirp.h"
 #include "crc.h"
+#include "css.h"
+#include "dsss.h"
+#include "echo.h"
+#include "filter.h"
+#include "fsk.h"
 #include "hamming.h"
+#include "ofdm.h"
+#include "pam.h"
+#include "phy_mode.h"
+#include "psk.h"
+#include "resample.h"
+#include "scrambler.h"
+#include "stream.h"
+#include "timing.h"
 #include "utils.h"
 
 BOOST_AUTO_TEST_CASE(np_test) {
@@ -131,4 +152,837 @@ BOOST_AUTO_TEST_CASE(CRCErrors) {
       crc_bits[i] = 1 - crc_bits[i];
     }
   }
-}
\ No newline at end of file
+}
+
+BOOST_AUTO_TEST_CASE(PhyHeaderField) {
+  using namespace SuperSonic;
+
+  PhyHeader::Value header{{Modulation::OFDM, Coding::RS1511},
+                          FrameFlags::Burst | FrameFlags::Scrambled,
+                          2,
+                          1234};
+  auto check = [&](const std::optional<PhyHeader::Value>& value) {
+    BOOST_REQUIRE(value.has_value());
+    BOOST_CHECK(value->mode == header.mode);
+    BOOST_CHECK_EQUAL(value->flags, header.flags);
+    BOOST_CHECK_EQUAL(value->dest, header.dest);
+    BOOST_CHECK_EQUAL(value->len, header.len);
+  };
+  {
+    auto encoded = PhyHeader::encode(header);
+    BOOST_CHECK_EQUAL(encoded.size(), PhyHeader::encoded_bits);
+    check(PhyHeader::decode(encoded));
+  }
+  {
+    // one bit error per codeword is corrected
+    for (size_t i = 0; i < 7; i++) {
+      auto encoded = PhyHeader::encode(header);
+      for (size_t j = i; j < encoded.size(); j += 7) {
+        encoded[j] = 1 - encoded[j];
+      }
+      check(PhyHeader::decode(encoded));
+    }
+  }
+  {
+    // two bit errors in a codeword are caught by the crc
+    auto encoded = PhyHeader::encode(header);
+    encoded[0] = 1 - encoded[0];
+    encoded[1] = 1 - encoded[1];
+    BOOST_CHECK(!PhyHeader::decode(encoded).has_value());
+  }
+  {
+    // truncated headers are rejected, not read past the end
+    auto encoded = PhyHeader::encode(header);
+    encoded.pop_back();
+    BOOST_CHECK(!PhyHeader::decode(encoded).has_value());
+    BOOST_CHECK(!PhyHeader::decode(Bits{}).has_value());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(ScramblerSequence) {
+  using namespace SuperSonic;
+
+  // bit by bit reference: s[n] = s[n - 14] ^ s[n - 15]
+  std::vector<uint8_t> s;
+  for (int i = 0; i < 15; i++) {
+    s.push_back((Scrambler::SEED >> i) & 1);
+  }
+  for (size_t n = 15; n < 15 + 40000; n++) {
+    s.push_back(s[n - 14] ^ s[n - 15]);
+  }
+
+  // a run of zeros comes out as the sequence, at any length
+  for (size_t len : {1, 63, 64, 65, 1000, 40000}) {
+    Bits bits(len, 0);
+    Scrambler().apply(bits);
+    BOOST_CHECK(std::equal(bits.begin(), bits.end(), s.begin() + 15));
+  }
+  // period 2^15 - 1, about balanced
+  BOOST_CHECK(std::equal(s.begin(), s.begin() + 15, s.begin() + 32767));
+  BOOST_CHECK_EQUAL(std::count(s.begin() + 15, s.begin() + 15 + 32767, 1),
+                    16384);
+
+  // twice is the identity, llrs flip where bits do
+  Bits bits(333);
+  for (size_t i = 0; i < bits.size(); i++) {
+    bits[i] = (i * 7 / 3) % 2;
+  }
+  auto scrambled = bits;
+  Scrambler().apply(scrambled);
+  Llrs llrs;
+  for (auto b : scrambled) {
+    llrs.push_back(b ? 2.5f : -2.5f);
+  }
+  Scrambler().apply(scrambled);
+  BOOST_CHECK(scrambled == bits);
+  Scrambler().apply(llrs);
+  BOOST_CHECK(hard_decision(llrs) == bits);
+}
+
+BOOST_AUTO_TEST_CASE(BurstFraming) {
+  using namespace SuperSonic;
+
+  std::vector<Bits> frames;
+  for (size_t len : {1, 40, 333}) {
+    Bits bits(len);
+    for (auto& e : bits) {
+      e = rand() % 2;
+    }
+    frames.push_back(bits);
+  }
+  auto packed = Burst::pack(frames);
+  BOOST_CHECK_EQUAL(packed.size(), Burst::packed_size(1) +
+                                       Burst::packed_size(40) +
+                                       Burst::packed_size(333));
+  {
+    auto unpacked = Burst::unpack(packed, 2048);
+    BOOST_CHECK(unpacked == frames);
+  }
+  {
+    // padding after the last sub-frame is ignored
+    auto padded = packed;
+    padded.resize(padded.size() + 5);
+    BOOST_CHECK(Burst::unpack(padded, 2048) == frames);
+  }
+  {
+    // a truncated sub-frame is dropped, the ones before are kept
+    auto truncated = packed;
+    truncated.resize(truncated.size() - 1);
+    auto unpacked = Burst::unpack(truncated, 2048);
+    BOOST_CHECK_EQUAL(unpacked.size(), 2);
+    BOOST_CHECK(unpacked[1] == frames[1]);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(LinkAdaptation) {
+  using namespace SuperSonic;
+
+  ASK ask;
+  auto ladder = LinkAdapter::make_ladder({
+      {{Modulation::ASK, Coding::None}, &ask},
+      {{Modulation::ASK, Coding::RS1511}, &ask},
+  });
+  BOOST_CHECK_EQUAL(ladder.size(), 2);
+  BOOST_CHECK(ladder[0].mode.coding == Coding::RS1511);
+  BOOST_CHECK(ladder[1].mode.coding == Coding::None);
+
+  LinkAdapter adapter(ladder, 3.0f, 2);
+  BOOST_CHECK_EQUAL(adapter.level(), 0);
+  // within hysteresis, stay
+  adapter.on_report(ladder[1].min_snr_db + 1.0f, 0);
+  adapter.on_report(ladder[1].min_snr_db + 1.0f, 0);
+  BOOST_CHECK_EQUAL(adapter.level(), 0);
+  // two good reports in a row, step up
+  adapter.on_report(ladder[1].min_snr_db + 4.0f, 0);
+  BOOST_CHECK_EQUAL(adapter.level(), 0);
+  adapter.on_report(ladder[1].min_snr_db + 4.0f, 0);
+  BOOST_CHECK_EQUAL(adapter.level(), 1);
+  // low snr, step down at once
+  adapter.on_report(ladder[1].min_snr_db - 1.0f, 0);
+  BOOST_CHECK_EQUAL(adapter.level(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(SoftDemodulation) {
+  using namespace SuperSonic;
+
+  constexpr size_t N = 256;
+  Bits bits(N);
+  for (size_t i = 0; i < N; i++) {
+    bits[i] = rand() % 2;
+  }
+
+  ASK ask;
+  auto wave = ask.modulate(bits);
+  for (auto& e : wave) {
+    e = e * 0.5f + 0.05f * ((float)rand() / RAND_MAX - 0.5f);
+  }
+  auto llrs = ask.demodulate_soft(wave);
+  BOOST_CHECK_EQUAL(llrs.size(), N);
+  BOOST_CHECK(hard_decision(llrs) == ask.demodulate(wave));
+  BOOST_CHECK(hard_decision(llrs) == bits);
+}
+
+BOOST_AUTO_TEST_CASE(TimingTracking) {
+  using namespace SuperSonic;
+
+  constexpr size_t N = 20000;
+  Bits bits(N);
+  for (size_t i = 0; i < N; i++) {
+    bits[i] = rand() % 2;
+  }
+
+  ASK ask;
+  auto wave = ask.modulate(bits);
+  // receiver clock 100 ppm faster, frame starts 0.2 samples late
+  constexpr double drift = 1e-4;
+  auto rx = Signal::fractional_resample(wave, 0.2, 1.0 / (1.0 + drift),
+                                        (size_t)(wave.size() * (1 + drift)));
+
+  auto result = TimingTracker::demodulate(ask, rx, wave.size());
+  BOOST_CHECK(hard_decision(result.llrs) == bits);
+  BOOST_CHECK(std::abs(result.drift - drift) < 3e-5);
+}
+
+BOOST_AUTO_TEST_CASE(StreamBlocks) {
+  using namespace SuperSonic;
+
+  constexpr size_t block_bits = 200;
+  constexpr size_t blocks = 30;
+  ASK ask;
+  auto sync_wave = ask.modulate(Stream::sync_word);
+  auto payload_size = ask.phy_payload_size(block_bits);
+  auto block_size = sync_wave.size() + payload_size;
+
+  std::vector<Bits> sent;
+  Samples wave;
+  for (size_t i = 0; i < blocks; i++) {
+    Bits bits(block_bits);
+    for (auto& b : bits) {
+      b = rand() % 2;
+    }
+    auto block_wave = Signal::concatenate(sync_wave, ask.modulate(bits));
+    wave.insert(wave.end(), block_wave.begin(), block_wave.end());
+    sent.push_back(std::move(bits));
+  }
+  // receiver clock 100 ppm faster, stream starts 0.3 samples late
+  constexpr double drift = 1e-4;
+  auto rx = Signal::fractional_resample(wave, -0.3, 1.0 / (1.0 + drift),
+                                        (size_t)(wave.size() * (1 + drift)));
+  // frame gap
+  rx.resize(rx.size() + 48, 0.0f);
+
+  auto receive = [&](Stream::State state, size_t lost_after) {
+    for (size_t i = 0; i < blocks; i++) {
+      BOOST_REQUIRE(state.wave.size() >=
+                    Stream::samples_needed(state, block_size, 200, 48));
+      auto block =
+          Stream::demodulate_block(ask, sync_wave, payload_size, 200, state);
+      if (i < lost_after) {
+        BOOST_CHECK(hard_decision(block.llrs) == sent[i]);
+        continue;
+      }
+      // no sync word, the lock holds for MAX_MISSES - 1 blocks
+      if (i + 1 < lost_after + Stream::MAX_MISSES) {
+        BOOST_CHECK(block.sync_corr < Stream::SYNC_THRESHOLD);
+        BOOST_CHECK(!block.llrs.empty());
+      } else {
+        BOOST_CHECK(block.llrs.empty());
+        return state;
+      }
+    }
+    return state;
+  };
+
+  {
+    // timing is carried from block to block: the drift accumulates to
+    // more than a sample over the stream, every block still decodes and the
+    // tracked position ends at the end of the stream
+    auto state = receive(Stream::State{{}, blocks, rx, 0.3}, blocks);
+    auto end = rx.size() - state.wave.size() + state.pos;
+    BOOST_CHECK(std::abs(end - (0.3 + wave.size() * (1 + drift))) < 1.0);
+    BOOST_CHECK_EQUAL(state.misses, 0);
+  }
+  {
+    // the sync search recovers a start off by a few samples
+    receive(Stream::State{{}, blocks, rx, 0.3 + Stream::SYNC_SEARCH - 1},
+            blocks);
+  }
+  {
+    // silence after 10 blocks, the lock is lost
+    auto cut = rx;
+    std::fill(cut.begin() + 10 * block_size + 4, cut.end(), 0.0f);
+    receive(Stream::State{{}, blocks, cut, 0.3}, 10);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(CfarThreshold) {
+  using namespace SuperSonic;
+
+  auto chirp = Signal::generate_chirp1();
+  auto chirp_energy = Signal::dot(chirp, chirp);
+  std::mt19937 rng(1);
+
+  for (float sigma : {0.001f, 0.01f, 0.3f}) {
+    std::normal_distribution<float> noise(0.0f, sigma);
+    Cfar cfar(chirp_energy, 6.0f);
+    Samples window(chirp.size());
+    size_t false_alarms = 0;
+    for (size_t i = 0; i < 100000; i++) {
+      cfar.update(window[0]);
+      std::copy(window.begin() + 1, window.end(), window.begin());
+      window.back() = noise(rng);
+      if (i > 2 * chirp.size() &&
+          Signal::dot(window, chirp) > cfar.threshold()) {
+        false_alarms++;
+      }
+    }
+    // the threshold follows the noise, not a fixed level
+    BOOST_CHECK_EQUAL(false_alarms, 0);
+    BOOST_CHECK(std::abs(cfar.noise_power() / (sigma * sigma) - 1) < 0.2);
+
+    // a chirp as strong as the noise is still detected
+    Samples rx(chirp.size());
+    for (size_t i = 0; i < chirp.size(); i++) {
+      rx[i] = sigma * chirp[i] + noise(rng);
+    }
+    BOOST_CHECK(Signal::dot(rx, chirp) > cfar.threshold());
+
+    // the gain halves, after a loud frame: noise and chirp with it
+    cfar.rescale(0.5f);
+    BOOST_CHECK(
+        std::abs(cfar.noise_power() / (0.25f * sigma * sigma) - 1) < 0.2);
+    for (auto& e : rx) {
+      e *= 0.5f;
+    }
+    BOOST_CHECK(Signal::dot(rx, chirp) > cfar.threshold());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(AutomaticGain) {
+  using namespace SuperSonic;
+
+  Agc agc;
+  auto rms_after = [&](float amplitude) {
+    Samples block(256);
+    for (size_t i = 0; i < block.size(); i++) {
+      block[i] = amplitude * std::sin(0.3f * i);
+    }
+    agc.process(block);
+    return std::sqrt(Signal::dot(block, block) / block.size());
+  };
+
+  // the level settles at the target whatever the capture gain
+  for (size_t i = 0; i < 2000; i++) {
+    rms_after(0.001f);
+  }
+  BOOST_CHECK(std::abs(rms_after(0.001f) - 0.5f) < 0.05f);
+
+  // fast attack: a 40 dB jump is brought down within a few blocks
+  rms_after(0.1f);
+  rms_after(0.1f);
+  BOOST_CHECK(rms_after(0.1f) < 1.0f);
+  for (size_t i = 0; i < 10; i++) {
+    rms_after(0.1f);
+  }
+  BOOST_CHECK(std::abs(rms_after(0.1f) - 0.5f) < 0.05f);
+
+  // slow decay: the gain holds through a short quiet gap
+  for (size_t i = 0; i < 10; i++) {
+    rms_after(0.01f);
+  }
+  BOOST_CHECK(rms_after(0.01f) < 0.1f);
+
+  // polarity
+  agc.flip_polarity();
+  BOOST_CHECK(agc.gain() < 0);
+}
+
+BOOST_AUTO_TEST_CASE(RxBandFilter) {
+  using namespace SuperSonic;
+
+  BOOST_REQUIRE(BandFilter({0.0f, 12500.0f}).lowpass());
+  auto tone_gain = [&](float freq, float dc) {
+    BandFilter f({0.0f, 12500.0f});
+    Samples x(20000), y;
+    for (size_t i = 0; i < x.size(); i++) {
+      x[i] = dc + std::sin(2 * std::numbers::pi_v<float> * freq * i /
+                           kSampleRate);
+    }
+    // in uneven blocks, as rx_refill does
+    for (size_t i = 0, block = 1; i < x.size();
+         i += block, block = block * 7 % 251) {
+      auto n = std::min(block, x.size() - i);
+      f.process(SampleView{x}.subspan(i, n), y);
+    }
+    BOOST_REQUIRE_EQUAL(y.size(), x.size());
+    // after the dc blocker settled
+    auto tail = SampleView{y}.subspan(y.size() - 4800);
+    return std::sqrt(Signal::dot(tail, tail) / tail.size() * 2);
+  };
+  BOOST_CHECK(std::abs(tone_gain(1000, 0.0f) - 1) < 0.05f);
+  BOOST_CHECK(std::abs(tone_gain(9000, 0.0f) - 1) < 0.05f);
+  BOOST_CHECK(tone_gain(20000, 0.0f) < 0.01f);
+  // dc offset removed
+  BOOST_CHECK(std::abs(tone_gain(1000, 0.5f) - 1) < 0.05f);
+
+  // the whole spectrum of ask is signal, only dc is blocked
+  ASK ask;
+  BOOST_CHECK(!BandFilter(ask.band()).lowpass());
+}
+
+BOOST_AUTO_TEST_CASE(FullDuplexBands) {
+  using namespace SuperSonic;
+
+  Config::OFDMOption ofdm;
+  Config::DuplexOption duplex;
+  auto low = duplex.band_option(ofdm, false);
+  auto high = duplex.band_option(ofdm, true);
+  BOOST_CHECK(low.channels == std::vector<int>({1, 2, 3, 4, 5}));
+  BOOST_CHECK(high.channels == std::vector<int>({8, 9, 10, 11, 12}));
+  duplex.split_channel = 13;
+  BOOST_CHECK_THROW(duplex.band_option(ofdm, true), std::runtime_error);
+
+  // the peer sends in the low band while our own frame, far louder, plays
+  // in the high band
+  OFDM rx(low), tx(high);
+  std::mt19937 rng(1);
+  Bits bits(low.channels.size() * 40), own(high.channels.size() * 40);
+  for (auto& b : bits) {
+    b = rng() % 2;
+  }
+  for (auto& b : own) {
+    b = rng() % 2;
+  }
+  auto wave = rx.modulate(bits);
+  // band-limited as Sphy sends it, and not aligned with the peer's symbols
+  Samples echo;
+  BandFilter tx_filter(tx.band());
+  tx_filter.process(tx.modulate(own), echo);
+  BOOST_REQUIRE_EQUAL(wave.size(), echo.size());
+  for (size_t i = 0; i < wave.size(); i++) {
+    wave[i] = 0.05f * wave[i] + 0.5f * echo[(i + 17) % echo.size()];
+  }
+
+  BandFilter filter(rx.band());
+  BOOST_CHECK(filter.lowpass());
+  BOOST_CHECK(!filter.highpass());
+  Samples y;
+  filter.process(wave, y);
+  filter.process(Signal::zeros(filter.delay()), y);
+  auto filtered = SampleView{y}.subspan(filter.delay(), wave.size());
+  BOOST_CHECK(rx.demodulate(filtered) == bits);
+
+  // the other end keeps the low band out with a high-pass
+  BandFilter upper(tx.band());
+  BOOST_CHECK(upper.highpass());
+  auto tone_gain = [](BandFilter f, float freq) {
+    Samples x(9600), y;
+    for (size_t i = 0; i < x.size(); i++) {
+      x[i] = std::sin(2 * std::numbers::pi_v<float> * freq * i / kSampleRate);
+    }
+    f.process(x, y);
+    auto tail = SampleView{y}.subspan(y.size() - 4800);
+    return std::sqrt(Signal::dot(tail, tail) / tail.size() * 2);
+  };
+  BOOST_CHECK(std::abs(tone_gain(upper, 10000) - 1) < 0.05f);
+  BOOST_CHECK(tone_gain(upper, 3000) < 0.01f);
+}
+
+BOOST_AUTO_TEST_CASE(EchoCancellation) {
+  using namespace SuperSonic;
+
+  // the device: our output comes back after 40 samples through a short
+  // room response
+  Config::EchoOption opt;
+  opt.delay = 32;
+  opt.taps = 64;
+  EchoCanceller echo(opt);
+  const std::vector<std::pair<size_t, float>> path{
+      {40, 0.6f}, {45, -0.3f}, {60, 0.1f}};
+
+  std::mt19937 rng(1);
+  std::uniform_real_distribution<float> out(-0.5f, 0.5f);
+  std::normal_distribution<float> noise(0.0f, 1e-3f);
+  size_t total = kSampleRate * 3;
+  Samples tx(total), rx(total), far(total, 0.0f);
+  for (auto& e : tx) {
+    e = out(rng);
+  }
+  // another node starts sending in the last second, while we still do
+  for (size_t i = 2 * kSampleRate; i < total; i++) {
+    far[i] = 0.05f * std::sin(2 * std::numbers::pi_v<float> * 3000 * i /
+                              kSampleRate);
+  }
+  for (size_t i = 0; i < total; i++) {
+    rx[i] = far[i] + noise(rng);
+    for (auto [d, h] : path) {
+      if (i >= d) {
+        rx[i] += h * tx[i - d];
+      }
+    }
+  }
+
+  // in callbacks of 256 samples
+  Samples clean(total);
+  for (size_t i = 0; i < total; i += 256) {
+    auto n = std::min<size_t>(256, total - i);
+    echo.process(rx.data() + i, tx.data() + i, clean.data() + i, n);
+  }
+
+  // the echo path is learnt
+  auto w = echo.weights();
+  BOOST_CHECK(std::abs(w[opt.taps - 1 - 8] - 0.6f) < 0.02f);
+  BOOST_CHECK(std::abs(w[opt.taps - 1 - 13] + 0.3f) < 0.02f);
+  BOOST_CHECK(std::abs(w[opt.taps - 1 - 28] - 0.1f) < 0.02f);
+
+  // over the last second, while the other node sends: the echo, 15 dB
+  // above it, is down by 25 dB, and it is left as it was
+  double echo_energy = 0, residual = 0, far_energy = 0;
+  for (size_t i = 2 * kSampleRate; i < total; i++) {
+    echo_energy += (rx[i] - far[i]) * (rx[i] - far[i]);
+    residual += (clean[i] - far[i]) * (clean[i] - far[i]);
+    far_energy += far[i] * far[i];
+  }
+  BOOST_CHECK(10 * std::log10(echo_energy / far_energy) > 14);
+  BOOST_CHECK(10 * std::log10(echo_energy / residual) > 25);
+  BOOST_CHECK(10 * std::log10(far_energy / residual) > 10);
+}
+
+BOOST_AUTO_TEST_CASE(FixedOfdmKernel) {
+  using namespace SuperSonic;
+
+  std::mt19937 rng(1);
+  auto random_bits = [&](size_t n) {
+    Bits bits(n);
+    for (auto& b : bits) {
+      b = rng() % 2;
+    }
+    return bits;
+  };
+
+  // a profile without a kernel, and the same profile fixed at compile
+  // time: both sum table rows to the channels of the symbol, cyclic prefix
+  // first
+  const std::vector<int> channels{3, 5, 6, 7, 9, 10};
+  OFDM generic(Config::OFDMOption(1000, channels, 12));
+  BOOST_CHECK(!generic.fixed_kernel());
+  FixedOFDMKernel<48, 12, 3, 5, 6, 7, 9, 10> kernel;
+  auto bits = random_bits(channels.size() * 50);
+  auto wave = generic.modulate(bits);
+  Samples fixed_wave(wave.size());
+  kernel.modulate(bits, fixed_wave);
+  for (size_t i = 0; i < wave.size(); i++) {
+    auto s = i / 60, n = (i % 60 + 48 - 12) % 48;
+    float expected = 0.0f;
+    for (size_t c = 0; c < channels.size(); c++) {
+      auto w = 2 * std::numbers::pi * channels[c] * n / 48;
+      expected += (bits[s * channels.size() + c] ? std::sin(w) : std::cos(w)) /
+                  channels.size();
+    }
+    BOOST_REQUIRE_SMALL(wave[i] - expected, 1e-5f);
+    BOOST_REQUIRE_SMALL(fixed_wave[i] - expected, 1e-5f);
+  }
+
+  // and read back as the FFT of the kiss_fft path does
+  std::normal_distribution<float> noise(0.0f, 0.05f);
+  for (auto& e : wave) {
+    e += noise(rng);
+  }
+  auto expected_metrics = generic.metrics(wave);
+  Samples metrics(expected_metrics.size());
+  kernel.metrics(wave, metrics);
+  for (size_t i = 0; i < metrics.size(); i++) {
+    BOOST_REQUIRE_SMALL(metrics[i] - expected_metrics[i], 1e-4f);
+  }
+
+  // the production profiles are served by a kernel
+  Config::OFDMOption ofdm;
+  Config::DuplexOption duplex;
+  for (auto& opt : {ofdm, duplex.band_option(ofdm, false),
+                    duplex.band_option(ofdm, true)}) {
+    OFDM modulator(opt);
+    BOOST_CHECK(modulator.fixed_kernel());
+    auto bits = random_bits(opt.channels.size() * 20);
+    BOOST_CHECK(modulator.demodulate(modulator.modulate(bits)) == bits);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(PulseShapedPam) {
+  using namespace SuperSonic;
+
+  std::mt19937 rng(1);
+  for (int levels : {2, 4, 8}) {
+    for (int sps : {3, 4, 8}) {
+      Config::PAMOption opt;
+      opt.levels = levels;
+      opt.symbol_samples = sps;
+      PAM pam(opt);
+
+      Bits bits(pam.bits_per_symbol() * 1000);
+      for (auto& b : bits) {
+        b = rng() % 2;
+      }
+      auto wave = pam.modulate(bits);
+      BOOST_CHECK_EQUAL(wave.size(), pam.phy_payload_size(bits.size()));
+      BOOST_CHECK(std::all_of(wave.begin(), wave.end(),
+                              [](float e) { return std::abs(e) <= 1.0f; }));
+
+      // no intersymbol interference through the matched filter
+      BOOST_CHECK(pam.demodulate(wave) == bits);
+
+      // unknown channel gain, and noise 10 dB below the closest levels
+      std::normal_distribution<float> noise(0.0f, 0.03f / (levels - 1));
+      for (auto& e : wave) {
+        e = 0.3f * e + noise(rng);
+      }
+      auto llrs = pam.demodulate_soft(wave);
+      BOOST_CHECK(hard_decision(llrs) == bits);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(MaryFsk) {
+  using namespace SuperSonic;
+
+  std::mt19937 rng(1);
+  for (int tones : {2, 4, 8, 16}) {
+    Config::FSKOption opt;
+    opt.tones = tones;
+    FSK fsk(opt);
+
+    Bits bits(fsk.bits_per_symbol() * 500);
+    for (auto& b : bits) {
+      b = rng() % 2;
+    }
+    auto wave = fsk.modulate(bits);
+    BOOST_CHECK_EQUAL(wave.size(), fsk.phy_payload_size(bits.size()));
+    BOOST_CHECK(fsk.demodulate(wave) == bits);
+
+    // continuous phase: no step larger than the highest tone makes
+    auto max_step = 2 * std::sin(std::numbers::pi_v<float> *
+                                 (opt.first_bin + tones - 1) /
+                                 opt.symbol_samples);
+    for (size_t i = 1; i < wave.size(); i++) {
+      BOOST_REQUIRE(std::abs(wave[i] - wave[i - 1]) <= max_step + 1e-4f);
+    }
+
+    // unknown gain and 0 dB sample snr
+    std::normal_distribution<float> noise(0.0f, 0.1f);
+    for (auto& e : wave) {
+      e = 0.14f * e + noise(rng);
+    }
+    auto llrs = fsk.demodulate_soft(wave);
+    BOOST_CHECK(hard_decision(llrs) == bits);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(DifferentialPsk) {
+  using namespace SuperSonic;
+
+  std::mt19937 rng(1);
+  for (size_t bits_per_symbol : {1, 2}) {
+    DPSK dpsk(Config::DPSKOption{}, bits_per_symbol);
+
+    Bits bits(bits_per_symbol * 500);
+    for (auto& b : bits) {
+      b = rng() % 2;
+    }
+    auto wave = dpsk.modulate(bits);
+    BOOST_CHECK_EQUAL(wave.size(), dpsk.phy_payload_size(bits.size()));
+    BOOST_CHECK(dpsk.demodulate(wave) == bits);
+
+    // inverted, with a carrier phase drifting by 100 ppm and noise: no
+    // channel estimate
+    wave = Signal::fractional_resample(wave, 0.0, 1.0 - 1e-4, wave.size());
+    std::normal_distribution<float> noise(0.0f, 0.1f);
+    for (auto& e : wave) {
+      e = -0.5f * e + noise(rng);
+    }
+    auto llrs = dpsk.demodulate_soft(wave);
+    BOOST_CHECK(hard_decision(llrs) == bits);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(TabledSymbols) {
+  using namespace SuperSonic;
+
+  std::mt19937 rng(1);
+  Bits bits(2 * 100);
+  for (auto& b : bits) {
+    b = rng() % 2;
+  }
+
+  // FSK from the tone table keeps the phase running across symbols
+  Config::FSKOption fsk_opt;
+  FSK fsk(fsk_opt);
+  auto wave = fsk.modulate(bits);
+  double phase = 0.0;
+  for (size_t s = 0; s < bits.size() / 2; s++) {
+    auto tone = bits[2 * s] | bits[2 * s + 1] << 1;
+    auto w = 2 * std::numbers::pi * (fsk_opt.first_bin + tone) /
+             fsk_opt.symbol_samples;
+    for (int j = 0; j < fsk_opt.symbol_samples; j++) {
+      BOOST_REQUIRE_SMALL(wave[s * fsk_opt.symbol_samples + j] -
+                              (float)std::sin(phase),
+                          1e-4f);
+      phase += w;
+    }
+  }
+
+  // DQPSK from the phase table, pi/4 steps by QUADRANT
+  Config::DPSKOption dpsk_opt;
+  DPSK dqpsk(dpsk_opt, 2);
+  wave = dqpsk.modulate(bits);
+  const int quadrant[4] = {1, 3, -1, -3};
+  phase = 0.0;
+  for (size_t s = 0; s <= bits.size() / 2; s++) {
+    if (s > 0) {
+      phase += quadrant[bits[2 * s - 2] | bits[2 * s - 1] << 1] *
+               std::numbers::pi / 4;
+    }
+    for (int n = 0; n < dpsk_opt.symbol_samples; n++) {
+      auto w = 2 * std::numbers::pi * dpsk_opt.carrier_bin * n /
+               dpsk_opt.symbol_samples;
+      BOOST_REQUIRE_SMALL(wave[s * dpsk_opt.symbol_samples + n] -
+                              (float)std::cos(w + phase),
+                          1e-4f);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(ChirpSpreadSpectrum) {
+  using namespace SuperSonic;
+
+  std::mt19937 rng(1);
+  for (auto [sf, amp] : {std::pair{5, 1.0f}, std::pair{7, 0.5f}}) {
+    Config::CSSOption opt;
+    opt.spreading_factor = sf;
+    CSS css(opt);
+
+    Bits bits(sf * 20);
+    for (auto& b : bits) {
+      b = rng() % 2;
+    }
+    auto wave = css.modulate(bits);
+    BOOST_CHECK_EQUAL(wave.size(), css.phy_payload_size(bits.size()));
+    BOOST_CHECK(css.demodulate(wave) == bits);
+
+    // the processing gain pulls symbols out from under the noise: -3 dB
+    // sample snr at sf 5, -9 dB at sf 7
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    for (auto& e : wave) {
+      e = amp * e + noise(rng);
+    }
+    auto llrs = css.demodulate_soft(wave);
+    BOOST_CHECK(hard_decision(llrs) == bits);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(GoldCodes) {
+  using namespace SuperSonic;
+
+  for (auto [degree, bound] : {std::pair{5, 9.0f}, std::pair{7, 17.0f}}) {
+    auto codes = Gold::codes(degree);
+    auto n = ((size_t)1 << degree) - 1;
+    BOOST_CHECK_EQUAL(codes.size(), n + 2);
+    // cyclic cross correlation of any two codes, at any shift
+    for (size_t a = 0; a < codes.size(); a += 3) {
+      for (size_t b = a + 1; b < codes.size(); b += 5) {
+        for (size_t shift = 0; shift < n; shift++) {
+          float cc = 0.0f;
+          for (size_t j = 0; j < n; j++) {
+            cc += codes[a][j] * codes[b][(j + shift) % n];
+          }
+          BOOST_REQUIRE(std::abs(cc) <= bound);
+        }
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(ConcurrentDsss) {
+  using namespace SuperSonic;
+
+  std::mt19937 rng(1);
+  auto random_bits = [&](size_t n) {
+    Bits bits(n);
+    for (auto& b : bits) {
+      b = rng() % 2;
+    }
+    return bits;
+  };
+
+  Config::DSSSOption opt_a, opt_b;
+  opt_a.code = 3;
+  opt_b.code = 7;
+  DSSS a(opt_a), b(opt_b);
+  auto bits_a = random_bits(100);
+  auto bits_b = random_bits(100);
+  auto wave_a = a.modulate(bits_a);
+  auto wave_b = b.modulate(bits_b);
+  BOOST_CHECK_EQUAL(wave_a.size(), a.phy_payload_size(bits_a.size()));
+
+  // both nodes at once, inverted, in noise
+  std::normal_distribution<float> noise(0.0f, 0.5f);
+  Samples rx(wave_a.size());
+  for (size_t i = 0; i < rx.size(); i++) {
+    rx[i] = -(wave_a[i] + 0.8f * wave_b[i]) + noise(rng);
+  }
+
+  // listening to everyone follows the stronger one
+  DSSS any(Config::DSSSOption{});
+  BOOST_CHECK(any.demodulate(rx) == bits_a);
+  BOOST_CHECK_EQUAL(any.last_rx_code(), 3);
+
+  // each peer's code despreads its own transmission
+  Config::DSSSOption only_b;
+  only_b.peer_codes = {7};
+  DSSS rx_b(only_b);
+  BOOST_CHECK(rx_b.demodulate(rx) == bits_b);
+}
+
+BOOST_AUTO_TEST_CASE(FractionalPeak) {
+  using namespace SuperSonic;
+
+  auto chirp = Signal::generate_chirp1();
+  auto padded = Signal::concatenate(Signal::zeros(50), chirp,
+                                    Signal::zeros(50));
+  for (double delay : {-0.4, -0.25, 0.0, 0.1, 0.3}) {
+    auto rx = Signal::fractional_resample(padded, -delay, 1.0, padded.size());
+    // correlation of the window starting at each lag, as receive_frame does
+    Samples corr(padded.size() - chirp.size());
+    for (size_t k = 0; k < corr.size(); k++) {
+      corr[k] = Signal::dot(SampleView{rx}.subspan(k, chirp.size()),
+                            SampleView{chirp});
+    }
+    auto peak = Signal::argmax(corr);
+    auto offset =
+        Signal::parabolic_peak(corr[peak - 1], corr[peak], corr[peak + 1]);
+    BOOST_CHECK(std::abs(peak + offset - (50 + delay)) < 0.1);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(StreamingResampler) {
+  using namespace SuperSonic;
+
+  constexpr size_t N = 4096;
+  constexpr double step = 1.0 + 1e-4;
+  Samples x(N);
+  for (size_t i = 0; i < N; i++) {
+    x[i] = std::sin(0.05f * i) + 0.5f * std::sin(0.31f * i);
+  }
+
+  // block by block, with varying block sizes
+  Resampler resampler(step);
+  Samples y;
+  for (size_t i = 0, block = 1; i < N; i += block, block = block * 3 % 257) {
+    auto n = std::min(block, N - i);
+    resampler.process(SampleView{x}.subspan(i, n), y);
+  }
+
+  auto expected = Signal::fractional_resample(x, 0.0, step, y.size());
+  BOOST_CHECK(y.size() + 4 >= N / step);
+  for (size_t i = 0; i < y.size(); i++) {
+    BOOST_CHECK(std::abs(y[i] - expected[i]) < 1e-4f);
+  }
+}
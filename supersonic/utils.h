@@ -1,6 +1,7 @@
 #pragma once
 
 #include <AudioFile.h>
+#include <algorithm>
 #include <numbers>
 #include <optional>
 #include <span>
@@ -74,6 +75,9 @@ using SampleView = std::span<const float>;
 using MutBitView = std::span<uint8_t>;
 using MutByteView = std::span<uint8_t>;
 using MutSampleView = std::span<float>;
+// soft bits, log(P(1) / P(0))
+using Llrs = std::vector<float>;
+using LlrView = std::span<const float>;
 
 namespace Signal {
 
@@ -192,8 +196,84 @@ auto sine_wave(float freq, V t, float phase = 0) {
   return result;
 }
 
+// scale raw decision metrics (positive means 1) to llrs,
+// assuming an antipodal signal in gaussian noise
+inline Llrs metrics_to_llrs(Samples metrics) {
+  if (metrics.empty()) {
+    return metrics;
+  }
+  float amp = 0.0f;
+  for (auto m : metrics) {
+    amp += std::abs(m);
+  }
+  amp /= metrics.size();
+  float var = 0.0f;
+  for (auto m : metrics) {
+    var += (std::abs(m) - amp) * (std::abs(m) - amp);
+  }
+  var = std::max(var / metrics.size(), 1e-6f * amp * amp + 1e-12f);
+  for (auto& m : metrics) {
+    m *= 2 * amp / var;
+  }
+  return metrics;
+}
+
+// llrs of noncoherent M-ary detection, from mags: the magnitude of each of
+// the m candidates per symbol, candidate v carrying the bits of v (lsb
+// first). Max-log: for each bit, the strongest candidate with the bit 1
+// against the strongest with the bit 0, scaled by the signal amplitude
+// over the noise in the candidates not chosen.
+inline Llrs max_log_llrs(SampleView mags, size_t m, size_t bits) {
+  if (mags.empty() || m < 2 || mags.size() % m != 0) {
+    return {};
+  }
+  auto symbols = mags.size() / m;
+
+  float amp = 0.0f, noise = 0.0f;
+  for (size_t s = 0; s < symbols; s++) {
+    auto candidates = mags.subspan(s * m, m);
+    auto best = std::max_element(candidates.begin(), candidates.end()) -
+                candidates.begin();
+    amp += candidates[best];
+    for (size_t k = 0; k < m; k++) {
+      if ((long)k != best) {
+        noise += candidates[k] * candidates[k];
+      }
+    }
+  }
+  amp /= symbols;
+  noise = std::max(noise / (symbols * (m - 1)), 1e-6f * amp * amp + 1e-12f);
+  auto scale = 2 * amp / noise;
+
+  Llrs llrs;
+  llrs.reserve(symbols * bits);
+  for (size_t s = 0; s < symbols; s++) {
+    auto candidates = mags.subspan(s * m, m);
+    for (size_t b = 0; b < bits; b++) {
+      float m0 = 0.0f, m1 = 0.0f;
+      for (size_t k = 0; k < m; k++) {
+        if ((k >> b) & 1) {
+          m1 = std::max(m1, candidates[k]);
+        } else {
+          m0 = std::max(m0, candidates[k]);
+        }
+      }
+      llrs.push_back(scale * (m1 - m0));
+    }
+  }
+  return llrs;
+}
+
 }  // namespace Signal
 
+inline Bits hard_decision(LlrView llrs) {
+  Bits bits(llrs.size());
+  for (size_t i = 0; i < llrs.size(); i++) {
+    bits[i] = llrs[i] > 0;
+  }
+  return bits;
+}
+
 inline int calculateBestReorder(int size) {
   int bestP = 1;
   int minDifference = size;